@@ -1,5 +1,6 @@
 // example_main.cpp
 #include "ygg/engine.hpp"
+#include "ygg/scene_graph.hpp"
 #include <chrono>
 
 Ygg::RenderEngine engine;
@@ -12,20 +13,48 @@ void scroll_callback(GLFWwindow *window, double xOffset, double yOffset);
 
 int main() {
 
-    if (engine.initGL("shaders/vShader.glsl", "shaders/fShader2.glsl") != 0) {
+    if (engine.initGL("shaders/vShader.glsl", "shaders/fShader2.glsl", "shaders/vShaderInstanced.glsl") != 0) {
         return -1;
     }
 
     GLFWwindow *window = engine.getWindow();
+    // the demo's meshes are small and near the origin, so quantized positions lose nothing visible
+    engine.setVertexFormat(Ygg::VertexFormat::CompactQuantized);
 
     // create a few demo meshes
     Ygg::Mesh floor = engine.createBox({0.0f, -1.0f, 0.0f}, glm::quat(), 10.0f, 1.0f, 10.0f, {0.7f, 0.7f, 0.7f});
-    Ygg::Mesh torso = engine.createBox({0.0f, 0.5f, 0.0f}, glm::quat(), 0.6f, 0.9f, 0.3f, {0.8f, 0.3f, 0.3f});
-    Ygg::Mesh head = engine.createSphere({0.0f, 1.3f, 0.0f}, glm::quat(), 0.22f, {0.9f, 0.8f, 0.7f}, 16, 16);
-    Ygg::Mesh leftUpperArm = engine.createBox({-0.7f, 0.6f, 0.0f}, glm::quat(), 0.2f, 0.5f, 0.2f, {0.3f, 0.3f, 0.8f});
-    Ygg::Mesh rightUpperArm = engine.createBox({0.7f, 0.6f, 0.0f}, glm::quat(), 0.2f, 0.5f, 0.2f, {0.3f, 0.3f, 0.8f});
+    // the humanoid's parts are built at the origin; their mesh.model only holds each part's size,
+    // placement comes from the scene graph so it doesn't scale the children
+    Ygg::Mesh torso = engine.createBox({0.0f, 0.0f, 0.0f}, glm::quat(), 0.6f, 0.9f, 0.3f, {0.8f, 0.3f, 0.3f});
+    Ygg::Mesh head = engine.createSphere({0.0f, 0.0f, 0.0f}, glm::quat(), 0.22f, {0.9f, 0.8f, 0.7f}, 16, 16);
+    Ygg::Mesh leftUpperArm = engine.createBox({0.0f, 0.0f, 0.0f}, glm::quat(), 0.2f, 0.5f, 0.2f, {0.3f, 0.3f, 0.8f});
+    Ygg::Mesh rightUpperArm = engine.createBox({0.0f, 0.0f, 0.0f}, glm::quat(), 0.2f, 0.5f, 0.2f, {0.3f, 0.3f, 0.8f});
+
+    Ygg::SceneGraph scene;
+    Ygg::NodeHandle torsoNode = scene.create(0, glm::translate(glm::mat4(1.0f), {0.0f, 0.5f, 0.0f}));
+    Ygg::NodeHandle headNode = scene.create(torsoNode, glm::translate(glm::mat4(1.0f), {0.0f, 0.8f, 0.0f}));
+    // arms hang from the shoulder, so their node sits there and the mesh is offset below it
+    Ygg::NodeHandle leftShoulder = scene.create(torsoNode, glm::translate(glm::mat4(1.0f), {-0.7f, 0.35f, 0.0f}));
+    Ygg::NodeHandle rightShoulder = scene.create(torsoNode, glm::translate(glm::mat4(1.0f), {0.7f, 0.35f, 0.0f}));
+    glm::mat4 armOffset = glm::translate(glm::mat4(1.0f), {0.0f, -0.25f, 0.0f});
+
+    // the engine keeps the renderables; parts attached to a node follow it every frame
+    engine.createRenderable(floor, floor.model);
+    engine.createRenderable(torso, glm::mat4(1.0f), torsoNode, torso.model);
+    engine.createRenderable(head, glm::mat4(1.0f), headNode, head.model);
+    engine.createRenderable(leftUpperArm, glm::mat4(1.0f), leftShoulder, armOffset * leftUpperArm.model);
+    engine.createRenderable(rightUpperArm, glm::mat4(1.0f), rightShoulder, armOffset * rightUpperArm.model);
+
+    // a ring of beads drawn with one instanced call
+    Ygg::Mesh bead = engine.createSphere({0.0f, 0.0f, 0.0f}, glm::quat(), 0.1f, {0.9f, 0.7f, 0.2f}, 8, 8);
+    std::vector<glm::mat4> beads(64);
+    for (size_t b = 0; b < beads.size(); b++) {
+        float angle = glm::two_pi<float>() * b / beads.size();
+        beads[b] = glm::translate(glm::mat4(1.0f), {3.0f * cos(angle), -0.3f, 3.0f * sin(angle)});
+    }
 
-    static Ygg::Line thread = engine.createLine();
+    engine.initLineBatch("shaders/vLine.glsl", "shaders/fLine.glsl");
+    Ygg::LineBatch &lines = engine.getLineBatch();
     // simple GL state
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     
@@ -53,22 +82,31 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // engine.setCameraUniforms(cam);
-        float s = 1.0f + sin(i) * 0.5f;
-        glm::mat4 scaled = torso.model * glm::scale(glm::mat4(1.0f), glm::vec3(s));
-
-        // draw meshes (these meshes were baked with model transforms in createBox/createSphere)
-        glm::mat4 view = cam.getViewMatrix();
-        engine.drawMesh(floor, view, projection, cam.getCameraPos(), floor.model);
-        engine.drawMesh(torso, view, projection, cam.getCameraPos(), torso.model);
-        engine.drawMesh(head, view, projection, cam.getCameraPos(), head.model);
-        engine.drawMesh(leftUpperArm, view, projection, cam.getCameraPos(), leftUpperArm.model);
-        engine.drawMesh(rightUpperArm, view, projection, cam.getCameraPos(), rightUpperArm.model);
+        // the torso turns and the arms swing; the head follows the torso through the hierarchy
+        float swing = sin(i * 0.02f) * 0.6f;
+        scene.setLocal(torsoNode, glm::rotate(glm::translate(glm::mat4(1.0f), {0.0f, 0.5f, 0.0f}),
+                                              i * 0.005f, glm::vec3(0.0f, 1.0f, 0.0f)));
+        scene.setLocal(leftShoulder, glm::rotate(glm::translate(glm::mat4(1.0f), {-0.7f, 0.35f, 0.0f}),
+                                                 swing, glm::vec3(1.0f, 0.0f, 0.0f)));
+        scene.setLocal(rightShoulder, glm::rotate(glm::translate(glm::mat4(1.0f), {0.7f, 0.35f, 0.0f}),
+                                                  -swing, glm::vec3(1.0f, 0.0f, 0.0f)));
+        scene.update(&engine.getJobSystem());
+
+        engine.beginFrame(cam);
+        engine.submitRenderables(&scene);
 
         glm::vec3 p1 = glm::vec3(0, 5, 0);
         glm::vec3 p2 = glm::vec3(0,0,0);
         glm::vec3 ropecolor = {0,0,0};
-        engine.updateLine(thread, p1, p2, ropecolor);
-        engine.drawLine(thread, view, projection, cam.getCameraPos(), ropecolor);
+        lines.addLine(p1, p2, ropecolor);
+
+        // thread the beads together
+        std::vector<glm::vec3> necklace;
+        for (const glm::mat4 &b : beads) necklace.push_back(glm::vec3(b[3]));
+        lines.addPolyline(necklace, {0.9f, 0.9f, 0.9f}, true);
+
+        engine.endFrame();
+        engine.drawMeshInstanced(bead, beads);
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
@@ -79,6 +117,7 @@ int main() {
     // engine.cleanupMesh(head);
     engine.cleanupMesh(leftUpperArm);
     engine.cleanupMesh(rightUpperArm);
+    engine.cleanupMesh(bead);
 
     engine.terminate();
     return 0;
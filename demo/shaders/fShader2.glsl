@@ -6,27 +6,34 @@ in vec3 VertexColor;
 
 out vec4 FragColor;
 
-uniform vec3 lightPos;
-uniform vec3 lightColor;
-uniform vec3 cameraPos;
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPos;
+};
+
+layout (std140) uniform LightData {
+    vec4 lightPos;
+    vec4 lightColor;
+};
 
 void main() {
     // ambient
     float ambientStrength = 0.5;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = ambientStrength * lightColor.rgb;
 
     // diffuse
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * lightColor.rgb;
 
     // specular
     float specularStrength = 0.5;
-    vec3 viewDir = normalize(cameraPos - FragPos);
+    vec3 viewDir = normalize(cameraPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightColor;
+    vec3 specular = specularStrength * spec * lightColor.rgb;
 
     vec3 result = (ambient + diffuse + specular) * VertexColor;
     FragColor = vec4(result, 1.0);
@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec4 aColor;
+
+// per-frame values, shared by every draw (binding point 0)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPos;
+};
+
+out vec4 LineColor;
+
+void main(){
+    gl_Position = projection*view*vec4(aPos, 1.0);
+    LineColor = aColor;
+}
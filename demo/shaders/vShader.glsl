@@ -8,8 +8,16 @@ layout (location = 2) in vec3 aColor;
 // uniform float offSetX;
 // uniform float offSetY;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// inverse-transpose of model, computed once per object on the CPU
+uniform mat3 normalMatrix;
+// per-object colour, multiplies the vertex colour
+uniform vec3 objectColor;
+// per-frame values, shared by every draw (binding point 0)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPos;
+};
 out vec3 VertexColor;
 out vec3 FragPos;
 out vec3 Normal;
@@ -18,9 +26,9 @@ out vec3 Normal;
 
 void main(){
     FragPos = vec3(model*vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model)))*aNormal;
+    Normal = normalMatrix*aNormal;
     gl_Position = projection*view*model*vec4(aPos.x, aPos.y, aPos.z,  1.0);
     // pos = vec3(gl_Position.xyz); 
-    VertexColor = aColor;
+    VertexColor = aColor * objectColor;
     // TexCoord = aTexture;
 }
\ No newline at end of file
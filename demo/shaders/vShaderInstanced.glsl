@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec3 aColor;
+// per-instance model matrix, occupies locations 3-6
+layout (location = 3) in mat4 aModel;
+// per-instance normal matrix computed on the CPU, occupies locations 7-9
+layout (location = 7) in mat3 aNormalMatrix;
+// per-instance colour, multiplies the vertex colour
+layout (location = 10) in vec4 aInstanceColor;
+
+// per-frame values, shared by every draw (binding point 0)
+layout (std140) uniform FrameData {
+    mat4 projection;
+    mat4 view;
+    vec4 cameraPos;
+};
+out vec3 VertexColor;
+out vec3 FragPos;
+out vec3 Normal;
+
+void main(){
+    FragPos = vec3(aModel*vec4(aPos, 1.0));
+    Normal = aNormalMatrix*aNormal;
+    gl_Position = projection*view*vec4(FragPos, 1.0);
+    VertexColor = aColor * aInstanceColor.rgb;
+}
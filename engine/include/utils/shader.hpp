@@ -6,10 +6,18 @@
 #include "../glm/glm.hpp"
 #include "../glm/ext.hpp"
 #include <string>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+/*A uniform location resolved once after linking. Setting through a handle does no string work
+and no driver lookup. Handles to uniforms the linker removed are invalid and setting them is a no-op*/
+struct UniformHandle {
+    GLint location = -1;
+    bool valid() const { return location >= 0; }
+};
+
 /*Creates a shader Program*/
 class Shader {
     public: 
@@ -27,17 +35,38 @@ class Shader {
         //Use/activate the shader
         void use();
 
+        //Attaches the named uniform block (if the program uses it) to a uniform buffer binding point
+        void bindUniformBlock(const char *blockName, GLuint binding) const;
+
+        //Returns the cached handle for an active uniform (invalid if the program has no such uniform)
+        UniformHandle getUniform(const std::string &name) const;
+
         //Utility uniform functions
         void setBool(const std::string &name, bool value) const;
         void setInt(const std::string &name, int value) const;
         void setFloat(const std::string &name, float value) const;
-        void setMat4(const std::string &name, glm::mat4 value) const;
-        void setVec3(const std::string &name, glm::vec3 value) const;
+        void setMat3(const std::string &name, const glm::mat3 &value) const;
+        void setMat4(const std::string &name, const glm::mat4 &value) const;
+        void setVec3(const std::string &name, const glm::vec3 &value) const;
+
+        //Handle based setters for the hot path
+        void setBool(UniformHandle handle, bool value) const;
+        void setInt(UniformHandle handle, int value) const;
+        void setFloat(UniformHandle handle, float value) const;
+        void setMat3(UniformHandle handle, const glm::mat3 &value) const;
+        void setMat4(UniformHandle handle, const glm::mat4 &value) const;
+        void setVec3(UniformHandle handle, const glm::vec3 &value) const;
 
         /*return the C style source code for a shader type associated with this object.
         @param type The type of shader. v for Vertex and f for fragment*/
 
         const char* getshaderSource(const char type) const;
+
+    private:
+        //Active uniform name -> location, filled by program reflection right after linking
+        std::unordered_map<std::string, GLint> uniformLocations;
+
+        void reflectUniforms();
 };
 
 /*Creates a new Shader object. 
@@ -120,6 +149,36 @@ if(!success){
 //Delete the shaders as they're linked into our program and no longer necessarily
 glDeleteShader(vertex);
 glDeleteShader(fragment);
+
+reflectUniforms();
+}
+
+/*Queries every active uniform once so later lookups never reach the driver.*/
+inline void Shader::reflectUniforms(){
+    uniformLocations.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::string name(maxLength > 0 ? maxLength : 1, '\0');
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, (GLuint)i, maxLength, &length, &size, &type, &name[0]);
+        std::string uniformName(name.data(), length);
+
+        //Members of uniform blocks have no location
+        GLint location = glGetUniformLocation(ID, uniformName.c_str());
+        if (location < 0) continue;
+        uniformLocations[uniformName] = location;
+
+        //Arrays are reported as "name[0]", make them reachable by their plain name too
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+            uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+        }
+    }
 }
 
 inline Shader::Shader(){}
@@ -128,27 +187,68 @@ inline void Shader::use(){
     glUseProgram(ID);
 }
 
+inline void Shader::bindUniformBlock(const char *blockName, GLuint binding) const {
+    GLuint index = glGetUniformBlockIndex(ID, blockName);
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(ID, index, binding);
+    }
+}
+
+inline UniformHandle Shader::getUniform(const std::string &name) const {
+    UniformHandle handle;
+    auto it = uniformLocations.find(name);
+    if (it != uniformLocations.end()) handle.location = it->second;
+    return handle;
+}
+
 //Set uniform values
 inline void Shader::setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    setBool(getUniform(name), value);
 }
 
 inline void Shader::setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    setInt(getUniform(name), value);
 }
 
 inline void Shader::setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    setFloat(getUniform(name), value);
 }
 
-inline void Shader::setMat4(const std::string &name, glm::mat4 value) const{
-    //Second arg is how many matrices we're sending, third is whether we want to transpose matrix, 4th is thematrix data
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+inline void Shader::setMat3(const std::string &name, const glm::mat3 &value) const{
+    setMat3(getUniform(name), value);
+}
+
+inline void Shader::setMat4(const std::string &name, const glm::mat4 &value) const{
+    setMat4(getUniform(name), value);
+}
+
+inline void Shader::setVec3(const std::string &name, const glm::vec3 &value) const{
+    setVec3(getUniform(name), value);
+}
+
+inline void Shader::setBool(UniformHandle handle, bool value) const {
+    glUniform1i(handle.location, (int)value);
 }
 
-inline void Shader::setVec3(const std::string &name, glm::vec3 value) const{
+inline void Shader::setInt(UniformHandle handle, int value) const {
+    glUniform1i(handle.location, value);
+}
+
+inline void Shader::setFloat(UniformHandle handle, float value) const {
+    glUniform1f(handle.location, value);
+}
+
+inline void Shader::setMat3(UniformHandle handle, const glm::mat3 &value) const{
+    glUniformMatrix3fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+inline void Shader::setMat4(UniformHandle handle, const glm::mat4 &value) const{
     //Second arg is how many matrices we're sending, third is whether we want to transpose matrix, 4th is thematrix data
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+    glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+inline void Shader::setVec3(UniformHandle handle, const glm::vec3 &value) const{
+    glUniform3fv(handle.location, 1, glm::value_ptr(value));
 }
 
 inline const char* Shader::getshaderSource(const char type) const {
@@ -0,0 +1,51 @@
+#pragma once
+#include "ygg/job_system.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace Ygg {
+
+// Block compressed formats, 4x4 pixels per block:
+//   BC1   8 bytes, RGB (opaque)                       colour textures
+//   BC3  16 bytes, RGB plus a separate alpha block    colour with smooth alpha
+//   BC4   8 bytes, one channel (red)                  masks, roughness, height
+//   BC5  16 bytes, two channels (red, green)          tangent-space normal maps
+enum class BlockFormat : uint8_t { BC1, BC3, BC4, BC5 };
+
+// Fast fits colour endpoints to the block's bounding box. Normal fits them along the principal
+// axis of the colours and tries both alpha modes. High also refines the endpoints by least squares
+// and searches around the alpha endpoints, for several times the cost of Normal.
+enum class CompressQuality : uint8_t { Fast, Normal, High };
+
+inline size_t blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+inline size_t compressedSize(BlockFormat format, unsigned int width, unsigned int height) {
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+/*Encodes a width x height RGBA8 image (tightly packed, as stb_image returns it) into
+compressedSize() bytes of blocks, a row of blocks at a time from the top, in the layout
+glCompressedTexImage2D expects. Partial blocks at the right and bottom edges repeat the last
+column/row. Block rows are spread over jobs when given. BC1 ignores alpha, BC4 and BC5 read red
+and red+green.*/
+void compressBlocks(const uint8_t *rgba, unsigned int width, unsigned int height, BlockFormat format,
+                    CompressQuality quality, uint8_t *destination, JobSystem *jobs = nullptr);
+
+// the reverse, to RGBA8; channels the format doesn't store come out as 0 (alpha 255)
+void decompressBlocks(const uint8_t *blocks, unsigned int width, unsigned int height, BlockFormat format,
+                      uint8_t *rgba);
+
+// Peak signal to noise ratio of the encoded image against the source, in dB, over the channels
+// the format stores (infinite when they match exactly). Around 35 dB and up is hard to tell apart
+// from the source for colour; normal maps want more.
+struct CompressionReport {
+    float psnr = 0.0f;          // RGB for BC1/BC3, red for BC4, red+green for BC5
+    float alphaPsnr = 0.0f;     // BC3 only
+};
+
+CompressionReport measureCompression(const uint8_t *rgba, const uint8_t *blocks, unsigned int width,
+                                     unsigned int height, BlockFormat format);
+
+} // namespace Ygg
@@ -0,0 +1,99 @@
+#pragma once
+#include "ygg/culling.hpp"
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Ygg {
+
+struct Aabb {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    bool contains(const Aabb &other) const {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+    bool overlaps(const Aabb &other) const {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+    float surfaceArea() const {
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+// where origin + t * direction enters box (0 if origin is inside), or a negative value if the ray
+// misses it within maxDistance
+float intersectRay(const Aabb &box, const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance);
+
+struct RayHit {
+    uint32_t userData;
+    float distance;     // where the ray enters the leaf's (fattened) box
+};
+
+/*Dynamic AABB tree over the renderables of a scene. Leaves store a fattened copy of the object's
+box, so objects that move a little stay inside it and cost nothing; only objects that leave their
+fat box are removed and re-inserted. Inserts pick the sibling by surface area cost and every
+change walks back to the root refitting boxes and applying AVL-style rotations, so the tree stays
+close to balanced without periodic rebuilds.
+
+Queries are hierarchical: a subtree whose box is outside the frustum/ray/region is skipped, and a
+subtree wholly inside the frustum is accepted without testing its leaves. Queries only read the
+tree, so several may run at once as long as nothing is modifying it.*/
+class DynamicBvh {
+public:
+    static constexpr int32_t NullNode = -1;
+
+    // margin is added on every side of inserted boxes
+    explicit DynamicBvh(float margin = 0.1f) : margin(margin) {}
+
+    // returns a proxy id that stays valid until remove()
+    int32_t insert(const Aabb &box, uint32_t userData);
+    void remove(int32_t proxy);
+    // returns true if the proxy had to be re-inserted. displacement (the object's motion this frame)
+    // extends the fat box in that direction so steadily moving objects re-insert less often
+    bool move(int32_t proxy, const Aabb &box, const glm::vec3 &displacement = glm::vec3(0.0f));
+    void clear();
+
+    uint32_t getUserData(int32_t proxy) const { return nodes[proxy].userData; }
+    const Aabb& getFatAabb(int32_t proxy) const { return nodes[proxy].box; }
+    size_t size() const { return leafCount; }
+    int getHeight() const { return root == NullNode ? 0 : nodes[root].height; }
+
+    // user data of every leaf touching the frustum, appended to out
+    void queryFrustum(const Frustum &frustum, std::vector<uint32_t> &out) const;
+    // every leaf overlapping region, appended to out
+    void queryAabb(const Aabb &region, std::vector<uint32_t> &out) const;
+    // leaves hit by the ray within maxDistance, nearest first. direction need not be normalised;
+    // distances are in units of its length
+    void queryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                  std::vector<RayHit> &out) const;
+
+private:
+    struct Node {
+        Aabb box;
+        int32_t parent = NullNode;      // doubles as the next link while on the free list
+        int32_t child1 = NullNode;
+        int32_t child2 = NullNode;
+        int32_t height = -1;            // 0 for leaves, -1 for free nodes
+        uint32_t userData = 0;
+
+        bool isLeaf() const { return child1 == NullNode; }
+    };
+
+    int32_t allocateNode();
+    void freeNode(int32_t node);
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    int32_t balance(int32_t node);
+    void refit(int32_t node);
+    void collectLeaves(int32_t node, std::vector<uint32_t> &out) const;
+
+    std::vector<Node> nodes;
+    int32_t root = NullNode;
+    int32_t freeList = NullNode;
+    size_t leafCount = 0;
+    float margin;
+};
+
+} // namespace Ygg
@@ -0,0 +1,43 @@
+#pragma once
+#include "ygg/vertex_layout.hpp"
+#include "glm/glm.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace Ygg {
+
+// Local-space bounds of a mesh: an AABB and a sphere around the AABB centre that encloses every
+// vertex (tighter than the box's circumscribed sphere for round meshes)
+struct Bounds {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+Bounds computeBounds(const Vertex *vertices, size_t count);
+
+// World-space sphere (xyz centre, w radius) of bounds under model. Non-uniform scale is covered by
+// the largest axis scale.
+glm::vec4 transformSphere(const Bounds &bounds, const glm::mat4 &model);
+
+// World-space AABB of bounds under model (Arvo's method: transformed centre plus |M| * extent)
+void transformAabb(const Bounds &bounds, const glm::mat4 &model, glm::vec3 &outMin, glm::vec3 &outMax);
+
+// Six normalised planes (left, right, bottom, top, near, far) with the inside on the positive side,
+// extracted from a projection * view matrix (Gribb/Hartmann)
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+    bool containsSphere(const glm::vec4 &sphere) const;
+};
+
+// Tests count spheres given as separate x/y/z/radius arrays against the frustum, writing 1 to
+// visible[i] if sphere i touches it and 0 otherwise. Runs 8 spheres per iteration with AVX, 4 with
+// SSE, scalar otherwise. Returns the number of visible spheres.
+size_t cullSpheres(const Frustum &frustum, const float *x, const float *y, const float *z, const float *radius,
+                   size_t count, uint8_t *visible);
+
+} // namespace Ygg
@@ -4,38 +4,140 @@
 #include "glad/glad.h"
 #include "utils/shader.hpp"
 #include "utils/camera.hpp"
+#include "ygg/render_queue.hpp"
+#include "ygg/frame_data.hpp"
+#include "ygg/transform.hpp"
+#include "ygg/geometry_pool.hpp"
+#include "ygg/vertex_layout.hpp"
+#include "ygg/mesh_optimizer.hpp"
+#include "ygg/mesh_file.hpp"
+#include "ygg/culling.hpp"
+#include "ygg/occlusion.hpp"
+#include "ygg/lod.hpp"
+#include "ygg/renderables.hpp"
+#include "ygg/job_system.hpp"
+#include "ygg/texture.hpp"
+#include "ygg/line_batch.hpp"
+#include "ygg/stream_buffer.hpp"
 #include <GLFW/glfw3.h>
 #include "glm/glm.hpp"
 #include "glm/ext.hpp"
 #include <iostream>
 #include <vector>
+#include <map>
 #include <cmath>
+#include <algorithm>
 
 #define Program Shader
 
 namespace Ygg {
 
 struct Mesh {
-    unsigned int VAO = 0, VBO = 0, EBO = 0;
-    unsigned int indexCount = 0;
-    glm::mat4 model;
+    unsigned int VAO = 0;               // shared by every mesh in the same GeometryPool
+    unsigned int indexCount = 0;        // of the finest level
+    GLenum indexType = GL_UNSIGNED_INT; // narrowest type for the vertex count, picked at creation
+    GeometryHandle geometry = 0;        // vertex/index range inside the pool
+    VertexFormat format = VertexFormat::Standard;   // selects the pool
+    Dequantize dequantize = Dequantize(0.0f, 0.0f, 0.0f, 1.0f); // undoes CompactQuantized positions
+    Bounds bounds;                      // local space, before any dequantize
+    glm::mat4 model;                    // full object transform: position, orientation and scale
+    glm::vec3 color = glm::vec3(1.0f);  // multiplies the vertex colour
     std::vector<float> normals;
+
+    // levels of detail, finest first; all index the same vertex range. The level last drawn is kept
+    // per object by the caller (see submitMesh), as many objects share a Mesh
+    MeshLod lods[MAX_MESH_LODS];
+    uint8_t lodCount = 1;
 };
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 normal;
-    glm::vec3 color;
+enum class PrimitiveType : uint8_t { Box, Sphere };
+
+// Identifies one unit primitive in the cache; tessellation is ignored for boxes
+struct PrimitiveKey {
+    PrimitiveType type;
+    unsigned int stacks, slices;
+    VertexFormat format;
+
+    bool operator<(const PrimitiveKey &other) const {
+        if (format != other.format) return format < other.format;
+        if (type != other.type) return type < other.type;
+        if (stacks != other.stacks) return stacks < other.stacks;
+        return slices < other.slices;
+    }
 };
 
 struct Line {
 GLuint VAO, VBO;
 };
 
+class RenderEngine;
+
+// submitMesh for one chunk of RenderEngine::recordMeshes; only valid inside the chunk's body, and
+// safe to use alongside the other chunks' recorders
+class MeshRecorder {
+public:
+    void submit(const Mesh &mesh, const glm::mat4 &model, uint16_t material = 0, uint8_t *lodState = nullptr);
+    void submit(const Mesh &mesh, const glm::mat4 &model, const glm::vec3 &color, uint16_t material = 0,
+                uint8_t *lodState = nullptr);
+
+private:
+    friend class RenderEngine;
+    MeshRecorder(RenderEngine &engine, DrawRecorder &recorder) : engine(engine), recorder(recorder) {}
+
+    RenderEngine &engine;
+    DrawRecorder &recorder;
+};
+
 class RenderEngine {
 private:
+    friend class MeshRecorder;
     static GLFWwindow *window;
     Program program;
+    Program instancedProgram;
+    StandardUniforms programUniforms;
+
+    // std140 uniform blocks bound at FRAME_DATA_BINDING / LIGHT_DATA_BINDING. Both are written
+    // together into the stream and re-bound on every change
+    StreamBuffer uniformStream;
+    GLint uniformAlignment = 256;
+    FrameData frameData;
+    LightData lightData;
+    bool frameDataValid = false;
+    void uploadFrameBlocks();
+
+    // per-instance InstanceData for drawMeshInstanced (locations 3-10 of the pool VAO)
+    StreamBuffer instanceStream;
+
+    RenderQueue queue;
+    OcclusionCuller occlusion;
+    float lodBudget = 1.0f;
+    float lodHysteresis = 0.25f;
+    // the LOD to draw mesh with at model, from the current frame uniforms; lodState as in submitMesh
+    const MeshLod& chooseLod(const Mesh &mesh, const glm::mat4 &model, uint8_t *lodState);
+
+    // worker threads for the engine's own passes; the thread calling initGL is the main thread
+    JobSystem jobs;
+    TextureManager textures;
+
+    // engine-owned renderables (see renderables.hpp)
+    RenderRegistry registry;
+    DynamicBvh entityBvh;
+    uint64_t packedVersion = ~0ull;
+    std::vector<uint32_t> visibleEntities;
+    // one pool per vertex format, created on first use
+    GeometryPool pools[VERTEX_FORMAT_COUNT];
+    GeometryPool& getPool(VertexFormat format);
+    VertexFormat vertexFormat = VertexFormat::Standard;
+    LineBatch lineBatch;
+
+    // unit primitives uploaded once and shared by every box/sphere with the same tessellation
+    std::map<PrimitiveKey, Mesh> primitiveCache;
+    Mesh getPrimitive(const PrimitiveKey &key);
+    Mesh buildUnitBox(VertexFormat format);
+    Mesh buildUnitSphere(unsigned int stacks, unsigned int slices, VertexFormat format);
+
+    // turns on the per-instance attributes 3-10 of vao
+    void enableInstanceAttributes(GLuint vao);
 
     const unsigned int SCR_WIDTH = 800;
     const unsigned int SCR_HEIGHT = 600;
@@ -61,9 +163,18 @@ private:
         0,1,5, 5,4,0,  3,2,6, 6,7,3
     };
 
+    // optimizes the mesh, encodes the vertices in `format` and sub-allocates them from that format's pool
+    // lodStarts/lodErrors describe a LOD chain concatenated in indices (see optimizeMeshLods)
+    Mesh uploadMesh(std::vector<Vertex> vertices, std::vector<unsigned> indices, VertexFormat format,
+                    MeshOptimizeStats *stats = nullptr, const std::vector<uint32_t> &lodStarts = {0},
+                    const std::vector<float> &lodErrors = {0.0f});
+    const GeometryRange& getRange(const Mesh &mesh) const;
+
 public:
     // initGL will create the GLFW window, load GLAD and compile shaders
-    int initGL(const char *vShader = "../shaders/vshader.glsl", const char *fShader = "../shaders/fshader.glsl");
+    // vShaderInstanced is paired with fShader for drawMeshInstanced
+    int initGL(const char *vShader = "../shaders/vshader.glsl", const char *fShader = "../shaders/fshader.glsl",
+               const char *vShaderInstanced = "../shaders/vShaderInstanced.glsl");
 
     RenderEngine(){}
 
@@ -71,29 +182,127 @@ public:
 
     Camera createCamera(glm::vec3 pos = {0.0f, 0.0f, 3.0f});
 
+    // batched debug lines: add segments any time during the frame, endFrame draws them in one call
+    int initLineBatch(const char *vShader = "../shaders/vLine.glsl", const char *fShader = "../shaders/fLine.glsl");
+    LineBatch& getLineBatch();
+
+    // storage format for meshes created from now on (Standard, full float vertices, by default; the
+    // compact formats trade precision for bandwidth). Existing meshes keep the format they were created with
+    void setVertexFormat(VertexFormat format);
+    VertexFormat getVertexFormat() const;
+
     Line createLine();
     void updateLine(const Line& line, glm::vec3 p1, glm::vec3 p2, glm::vec3 color);
 
-    // createBox and createSphere create Mesh objects whose vertex positions are already transformed (simple)
+    // uploads an indexed triangle mesh in the current vertex format. The index order is optimized for
+    // the post-transform cache and overdraw first; stats receives the ACMR/ATVR before and after
+    Mesh createMesh(const std::vector<Vertex> &vertices, const std::vector<unsigned> &indices,
+                    const glm::vec3 &color = glm::vec3(1.0f), MeshOptimizeStats *stats = nullptr);
+
+    // LOD chain version: lodIndices[0] is the full mesh, later entries coarser versions indexing the
+    // same vertices, each with its geometric error in local units (at most MAX_MESH_LODS levels)
+    Mesh createMesh(const std::vector<Vertex> &vertices, const std::vector<std::vector<unsigned>> &lodIndices,
+                    const std::vector<float> &lodErrors, const glm::vec3 &color = glm::vec3(1.0f),
+                    MeshOptimizeStats *stats = nullptr);
+
+    // uploads an already encoded mesh as it is, e.g. MeshFile::mesh() straight from the mapped file;
+    // name is not kept
+    Mesh createMesh(const MeshData &data);
+
+    // Level of detail: the coarsest level whose error stays under budgetPixels on screen is drawn
+    // (1 pixel by default). hysteresis is the fraction of the budget an object must drop below
+    // before it switches to a coarser level
+    void setLodBudget(float budgetPixels, float hysteresis = 0.25f);
+
+    // createBox and createSphere share cached unit geometry; size, placement and colour only
+    // live in the returned Mesh (model, color)
     Mesh createBox(const glm::vec3 &pos, const glm::quat &orientation,
                    float width, float height, float depth, const glm::vec3 &color);
 
+    // spheres carry a LOD chain halving stacks and slices down to 4
     Mesh createSphere(const glm::vec3 &pos, const glm::quat &orientation,
                       float radius, const glm::vec3 &color,
                       unsigned int stacks = 12, unsigned int slices = 12);
 
     // drawing, cleanup, termination utilities
+    // overloads without view/projection use the frame uniforms from setCameraUniforms/setFrameUniforms
+    // lodState as in submitMesh
+    void drawMesh(const Mesh &mesh, const glm::mat4 &model, uint8_t *lodState = nullptr);
     void drawMesh(const Mesh &mesh,  const glm::mat4& view,  const glm::mat4& projection, const glm::vec3 &cameraPos, const glm::mat4 &rotAndPos);
+    // draws `count` copies of mesh in a single call, one model matrix per instance, always at the
+    // finest LOD since every instance shares the index range
+    void drawMeshInstanced(const Mesh &mesh, const glm::mat4 *models, size_t count);
+    void drawMeshInstanced(const Mesh &mesh, const std::vector<glm::mat4> &models);
+    void drawMeshInstanced(const Mesh &mesh, const glm::mat4 *models, size_t count,
+                           const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos);
+    void drawMeshInstanced(const Mesh &mesh, const std::vector<glm::mat4> &models,
+                           const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos);
+    void drawLine(const Line& line);
     void drawLine(const Line& line,
                             const glm::mat4& view,
                             const glm::mat4& proj,
                             const glm::vec3 &cameraPos,
                             glm::vec3 color);
+
+    // sorted submission: beginFrame, submitMesh for every object, then endFrame sorts and draws them
+    // (and flushes the line batch). endFrame also retires this frame's streamed data
+    void beginFrame(const Camera &cam);
+    void beginFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos);
+    // lodState is the drawn object's own byte of LOD state (start it at 0): it holds the level drawn
+    // last, for hysteresis, and is updated while recording. Without it the level is picked with the
+    // stricter coarsening budget every frame
+    void submitMesh(const Mesh &mesh, const glm::mat4 &model, uint16_t material = 0, uint8_t *lodState = nullptr);
+    // same with a colour other than mesh.color
+    void submitMesh(const Mesh &mesh, const glm::mat4 &model, const glm::vec3 &color, uint16_t material = 0,
+                    uint8_t *lodState = nullptr);
+    // submitMesh from the job system: body(recorder, begin, end) runs over [0, count) in chunks of
+    // grain items, each submitting through its own recorder. LOD selection and sort keys are worked
+    // out on the workers; endFrame merges the chunks and only the GL calls stay on this thread
+    void recordMeshes(size_t count, size_t grain,
+                      const std::function<void(MeshRecorder&, size_t, size_t)> &body);
+    void endFrame();
+
+    // Renderable entities: the engine keeps their transform, mesh, material, bounds and visibility
+    // as components in flat arrays. mesh must outlive the entity. With a scene node, the entity's
+    // transform follows world(node) * offset, and model is ignored
+    Entity createRenderable(const Mesh &mesh, const glm::mat4 &model = glm::mat4(1.0f), NodeHandle node = 0,
+                            const glm::mat4 &offset = glm::mat4(1.0f));
+    void destroyRenderable(Entity entity);
+    RenderRegistry& getRegistry();
+    // the engine's workers, also free for application jobs. Jobs queued with runOnMain run at the
+    // next beginFrame or endFrame, on the GL thread
+    JobSystem& getJobSystem();
+    // textures decode on the workers and upload a budget's worth per frame in beginFrame
+    TextureManager& getTextureManager();
+    // picking and region queries against the renderables' BVH, as of the last submitRenderables.
+    // pickRenderable returns 0 when nothing is hit; see Ygg::pickRenderable
+    Entity pickRenderable(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                          float *distance = nullptr);
+    void queryRenderables(const Aabb &region, std::vector<Entity> &out);
+    // between beginFrame and endFrame: runs the transform (when scene is given), bounds, culling
+    // and draw list systems over every renderable and submits the visible ones
+    void submitRenderables(const SceneGraph *scene = nullptr);
+    // Batched (default) groups submitted meshes into instanced draws, Immediate draws them one by one
+    void setSubmitMode(SubmitMode mode);
+    // frustum culling of submitted meshes (on by default); getRenderStats().culled counts the rejects
+    void setCulling(bool enabled);
+
+    // Occluders for the current frame (between beginFrame and endFrame). The mesh's bounding box is
+    // rasterized, so only pass meshes that fill it, like boxes; arbitrary triangles can be added
+    // through getOcclusionCuller(). Submitted meshes hidden behind them are skipped at endFrame
+    // and counted in getRenderStats().occluded
+    void addOccluder(const Mesh &mesh, const glm::mat4 &model);
+    OcclusionCuller& getOcclusionCuller();
+    const RenderQueueStats& getRenderStats() const;
+
     void cleanupMesh(Mesh &mesh);
     void terminate();
 
-    // set camera uniforms (view/proj) before drawing your scene
+    // set camera uniforms (view/proj) before drawing your scene. This is the once-per-frame update
+    // of the FrameData block; uploads are skipped when the values did not change
     void setCameraUniforms(const Camera &cam);
+    void setFrameUniforms(const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos);
+    void setLight(const glm::vec3 &pos, const glm::vec3 &color);
 };
 
 } // namespace Ygg
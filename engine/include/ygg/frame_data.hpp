@@ -0,0 +1,26 @@
+#pragma once
+#include "glm/glm.hpp"
+
+namespace Ygg {
+
+// Fixed uniform block binding points shared by every engine program
+constexpr unsigned int FRAME_DATA_BINDING = 0;
+constexpr unsigned int LIGHT_DATA_BINDING = 1;
+
+// CPU mirror of the std140 FrameData block. vec3s are stored as vec4 to match std140 padding.
+struct FrameData {
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::vec4 cameraPos = glm::vec4(0.0f);
+};
+
+// CPU mirror of the std140 LightData block
+struct LightData {
+    glm::vec4 lightPos = glm::vec4(0.0f, 10.0f, 3.0f, 1.0f);
+    glm::vec4 lightColor = glm::vec4(1.0f);
+};
+
+static_assert(sizeof(FrameData) == 144, "FrameData must match the std140 layout");
+static_assert(sizeof(LightData) == 32, "LightData must match the std140 layout");
+
+} // namespace Ygg
@@ -0,0 +1,92 @@
+#pragma once
+#include "glad/glad.h"
+#include "ygg/vertex_layout.hpp"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace Ygg {
+
+// First-fit free list over [0, capacity). Neighbouring free ranges are merged on free().
+class RangeAllocator {
+public:
+    // everything below `used` is considered allocated
+    void reset(uint32_t capacity, uint32_t used = 0);
+    bool allocate(uint32_t size, uint32_t alignment, uint32_t &offset);
+    void free(uint32_t offset, uint32_t size);
+    void grow(uint32_t newCapacity);
+
+    uint32_t capacity() const { return total; }
+    uint32_t freeSpace() const { return available; }
+    // free space that is not part of the trailing block, i.e. holes left behind by free()
+    uint32_t holeSpace() const;
+
+private:
+    std::map<uint32_t, uint32_t> freeRanges; // offset -> size
+    uint32_t total = 0;
+    uint32_t available = 0;
+};
+
+// Smallest index type that can address vertexCount vertices. GL_UNSIGNED_BYTE is only returned
+// when allowByte is set: many GPUs have no native 8-bit index fetch and widen them in the driver.
+GLenum chooseIndexType(uint32_t vertexCount, bool allowByte = false);
+uint32_t indexTypeSize(GLenum indexType);
+// Narrows 32-bit indices to indexType; out is resized to count * indexTypeSize(indexType) bytes
+void packIndices(const uint32_t *indices, size_t count, GLenum indexType, std::vector<unsigned char> &out);
+
+// 0 is never a valid handle
+using GeometryHandle = uint32_t;
+
+// Where an allocation currently lives. Compaction moves allocations, so ranges must be looked up
+// through the handle at draw time rather than cached.
+struct GeometryRange {
+    uint32_t firstVertex = 0;   // base vertex for glDrawElementsBaseVertex
+    uint32_t vertexCount = 0;
+    uint32_t indexOffset = 0;   // bytes into the index buffer
+    uint32_t indexBytes = 0;
+};
+
+/*Sub-allocates mesh vertices and indices out of one large vertex buffer and one large index buffer,
+all drawn through a single shared VAO. Indices stay relative to the mesh so moving the vertices
+(growth, compaction) never requires rewriting them. A pool holds a single VertexFormat.*/
+class GeometryPool {
+public:
+    // capacities in vertices and index bytes; both grow on demand
+    void init(VertexFormat format = VertexFormat::Standard,
+              uint32_t vertexCapacity = 1u << 16, uint32_t indexCapacity = 1u << 18);
+    void destroy();
+
+    // allocations are reference counted: allocate() returns one reference, retain() adds one and
+    // free() drops one, releasing the range when the last reference goes. vertices must already be
+    // encoded in the pool's format (see encodeVertices)
+    GeometryHandle allocate(const void *vertices, uint32_t vertexCount, const void *indices, uint32_t indexBytes);
+    void retain(GeometryHandle handle);
+    void free(GeometryHandle handle);
+
+    const GeometryRange& range(GeometryHandle handle) const { return ranges[handle]; }
+    GLuint vao() const { return VAO; }
+    VertexFormat format() const { return vertexFormat; }
+    bool isInitialized() const { return VAO != 0; }
+
+    // share of the buffers lost to holes between live allocations
+    float fragmentation() const;
+    // packs every live allocation to the front of the buffers
+    void compact();
+
+private:
+    void bindVertexLayout();
+    void resizeVertexBuffer(uint32_t capacity);
+    void resizeIndexBuffer(uint32_t capacity);
+
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    VertexFormat vertexFormat = VertexFormat::Standard;
+    GLsizeiptr stride = sizeof(Vertex);
+    RangeAllocator vertexSpace;     // in vertices
+    RangeAllocator indexSpace;      // in bytes
+
+    std::vector<GeometryRange> ranges;    // indexed by handle, slot 0 unused
+    std::vector<uint32_t> refs;         // 0 for unused slots
+    std::vector<GeometryHandle> freeHandles;
+};
+
+} // namespace Ygg
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ygg {
+
+using Job = std::function<void()>;
+
+class JobSystem;
+
+// Outstanding work: run() with a counter adds one, finishing the job removes it. Jobs queued with
+// runAfter() start once it drops to zero. A counter must outlive the jobs counted on it.
+class JobCounter {
+public:
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    struct Continuation {
+        Job job;
+        JobCounter *counter;
+    };
+
+    std::atomic<uint32_t> pending{0};
+    std::mutex lock;
+    std::vector<Continuation> continuations;
+};
+
+enum class ThreadAffinity {
+    None,       // the OS schedules workers freely
+    PinCores    // worker i runs on core i + 1 only, core 0 is left to the main thread
+};
+
+/*Work-stealing thread pool. Each worker owns a deque: it pushes and pops its own jobs at the back
+(most recent first, while their data is still in cache) and idle workers steal from the front of
+the others' (oldest first, usually the largest pieces of work). Jobs submitted from outside the
+pool go to the workers round robin.
+
+wait() never blocks a thread while work is queued: the waiting thread runs jobs itself until the
+counter is done, so jobs may wait on jobs they spawn.
+
+GL calls must stay on the context thread: runOnMain() queues a job there, and the main thread runs
+them in pumpMain() (the engine does at beginFrame and endFrame).*/
+class JobSystem {
+public:
+    JobSystem() = default;
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem() { shutdown(); }
+
+    // workers = 0 starts one per core besides the calling thread, which becomes the main thread.
+    // Without init, or with one core, every job runs inline on the submitting thread
+    void init(unsigned int workers = 0, ThreadAffinity affinity = ThreadAffinity::None);
+    // stops the workers; jobs still queued are dropped, so wait on outstanding counters first
+    void shutdown();
+
+    void run(Job job, JobCounter *counter = nullptr);
+    // run() once dependency is done (at once if it already is)
+    void runAfter(JobCounter &dependency, Job job, JobCounter *counter = nullptr);
+    // runs queued jobs on this thread until counter is done
+    void wait(JobCounter &counter);
+
+    // body(begin, end) over [0, count) in chunks of at most grain items, returns when all are done
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body);
+
+    void runOnMain(Job job);
+    // runs the jobs queued with runOnMain; call from the main thread only
+    void pumpMain();
+
+    unsigned int getWorkerCount() const { return static_cast<unsigned int>(workers.size()); }
+    // worker count plus the main thread, the number of threads parallelFor can spread over
+    unsigned int getThreadCount() const { return getWorkerCount() + 1; }
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<std::pair<Job, JobCounter*>> jobs;
+        std::thread thread;
+    };
+
+    void push(unsigned int worker, Job job, JobCounter *counter);
+    // pops from this thread's own deque first, then steals; false if every deque was empty
+    bool runOne(unsigned int self);
+    void execute(Job &job, JobCounter *counter);
+    void finish(JobCounter *counter);
+    void workerLoop(unsigned int index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<unsigned int> nextWorker{0};
+    std::atomic<size_t> queued{0};
+    std::atomic<bool> running{false};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+
+    std::mutex mainLock;
+    std::vector<Job> mainJobs;
+};
+
+} // namespace Ygg
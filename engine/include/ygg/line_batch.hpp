@@ -0,0 +1,46 @@
+#pragma once
+#include "glad/glad.h"
+#include "utils/shader.hpp"
+#include "ygg/stream_buffer.hpp"
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Ygg {
+
+// 16 byte line vertex: position plus RGBA8 colour
+struct LineVertex {
+    glm::vec3 pos;
+    uint32_t color;
+};
+
+/*Accumulates debug segments and polylines during the frame and draws them all with one GL_LINES
+call. Vertices are streamed through a fenced StreamBuffer, so filling it never waits on the GPU.*/
+class LineBatch {
+public:
+    // capacity is the expected number of vertices per frame (two per segment); the stream grows
+    // past it if needed
+    void init(const char *vShader, const char *fShader, size_t capacity = 1 << 18);
+    void destroy();
+
+    void addLine(const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &color);
+    // connects consecutive points; closed also joins the last point back to the first
+    void addPolyline(const glm::vec3 *points, size_t count, const glm::vec3 &color, bool closed = false);
+    void addPolyline(const std::vector<glm::vec3> &points, const glm::vec3 &color, bool closed = false);
+
+    // draws everything added since the last flush using the FrameData block, then clears
+    void flush();
+
+    size_t size() const { return vertices.size(); }
+    bool isInitialized() const { return VAO != 0; }
+
+private:
+    static uint32_t packColor(const glm::vec3 &color);
+
+    Shader program;
+    GLuint VAO = 0;
+    StreamBuffer stream;
+    std::vector<LineVertex> vertices;
+};
+
+} // namespace Ygg
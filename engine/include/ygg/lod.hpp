@@ -0,0 +1,29 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+namespace Ygg {
+
+constexpr unsigned int MAX_MESH_LODS = 6;
+
+// One level of detail: a slice of the mesh's index range drawn instead of the full mesh. error is
+// the largest distance (in the mesh's local units) between this level and the full mesh.
+struct MeshLod {
+    uint32_t indexOffset = 0;   // bytes from the mesh's first index
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+};
+
+// pixels one world unit covers at distance from the camera. projectionY is projection[1][1]
+inline float pixelsPerUnit(float projectionY, float viewportHeight, float distance) {
+    return projectionY * viewportHeight * 0.5f / std::max(distance, 1e-4f);
+}
+
+// Picks the coarsest level whose error projects to at most budget pixels. pixelsPerUnit converts
+// local units to pixels at the object's distance. Moving to a coarser level than current needs the
+// error to fit within budget * (1 - hysteresis), so objects near a threshold don't flicker between
+// levels.
+unsigned int selectLod(const MeshLod *lods, unsigned int lodCount, float pixelsPerUnit, unsigned int current,
+                       float budget, float hysteresis);
+
+} // namespace Ygg
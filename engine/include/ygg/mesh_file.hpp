@@ -0,0 +1,106 @@
+#pragma once
+#include "glad/glad.h"
+#include "ygg/vertex_layout.hpp"
+#include "ygg/mesh_optimizer.hpp"
+#include "ygg/culling.hpp"
+#include "ygg/lod.hpp"
+#include "glm/glm.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Ygg {
+
+/*A mesh in its GPU form: vertices encoded in their VertexFormat, indices packed to indexType and
+LOD levels as ranges of them. Only points at the data, which lives in an EncodedMesh or in a mapped
+.yggmesh file. RenderEngine::createMesh uploads it as it is.*/
+struct MeshData {
+    const char *name = "";
+    VertexFormat format = VertexFormat::Standard;
+    GLenum indexType = GL_UNSIGNED_INT;
+    uint32_t vertexCount = 0;
+    uint32_t indexBytes = 0;
+    const void *vertices = nullptr;     // vertexCount * getVertexLayout(format).stride bytes
+    const void *indices = nullptr;
+    Dequantize dequantize = Dequantize(0.0f, 0.0f, 0.0f, 1.0f);
+    Bounds bounds;
+    glm::vec3 color = glm::vec3(1.0f);
+    MeshLod lods[MAX_MESH_LODS];        // indexOffset in bytes into indices
+    uint8_t lodCount = 1;
+};
+
+// MeshData with storage, as built by encodeMesh
+struct EncodedMesh {
+    std::string name;
+    MeshData data;
+    std::vector<unsigned char> vertices, indices;
+
+    // data with its pointers aimed at this mesh's arrays
+    MeshData view() const;
+};
+
+// The cook step RenderEngine::createMesh runs on Vertex input: optimizes the index and vertex order
+// (see optimizeMeshLods), computes the bounds, encodes the vertices in format and packs the indices
+// to the narrowest type. lodStarts/lodErrors describe a LOD chain concatenated in indices.
+EncodedMesh encodeMesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, VertexFormat format,
+                       const std::vector<uint32_t> &lodStarts = {0}, const std::vector<float> &lodErrors = {0.0f},
+                       MeshOptimizeStats *stats = nullptr);
+
+/*.yggmesh: a header, a table of fixed size mesh records, then every mesh's vertex and index blobs,
+each starting on a MESH_FILE_ALIGNMENT boundary. A record carries the mesh's name, bounds, LOD
+ranges, index type and a copy of its vertex layout, so a file whose layout no longer matches the
+engine's is rejected instead of drawn wrong. Offsets are 64-bit, all values little-endian; the
+header carries a byte order mark and only little-endian hosts can build the reader and writer. The
+blobs are stored exactly as the GPU takes them, so loading is mapping the file and pointing
+glBufferSubData at it.
+
+The major version changes with any layout change of the header or records; readers reject other
+versions.*/
+constexpr uint32_t MESH_FILE_VERSION = 2;
+constexpr size_t MESH_FILE_ALIGNMENT = 64;
+
+// writes meshes to path; false if the file can't be written
+bool writeMeshFile(const std::string &path, const MeshData *meshes, size_t count);
+bool writeMeshFile(const std::string &path, const std::vector<EncodedMesh> &meshes);
+
+/*Read-only memory mapping of a .yggmesh file. open() checks the header and every record against
+the file size and the engine's vertex layouts, and every index against its mesh's vertex count, so
+a corrupt file is rejected rather than handed to the GPU. Only the index pages are read for that;
+vertex pages are read when mesh data is first used. MeshData from mesh() points into the mapping
+and is valid until close().*/
+class MeshFile {
+public:
+    MeshFile() = default;
+    MeshFile(const MeshFile&) = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+    ~MeshFile() { close(); }
+
+    // false, with the reason in getError(), if the file can't be mapped or fails validation
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    size_t size() const { return meshes.size(); }
+    const MeshData& mesh(size_t index) const { return meshes[index]; }
+    // index of the first mesh called name, or -1
+    int find(const std::string &name) const;
+
+    const std::string& getError() const { return error; }
+
+private:
+    bool fail(const std::string &reason);
+
+    const unsigned char *base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void *file = nullptr;
+    void *mapping = nullptr;
+#else
+    int file = -1;
+#endif
+    std::vector<MeshData> meshes;
+    std::string error;
+};
+
+} // namespace Ygg
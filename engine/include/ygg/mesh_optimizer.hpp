@@ -0,0 +1,56 @@
+#pragma once
+#include "ygg/vertex_layout.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ygg {
+
+// Post-transform cache behaviour of an index buffer, simulated as a FIFO of cacheSize entries.
+// acmr: vertices transformed per triangle (0.5 is ideal for large regular meshes, 3 is the worst)
+// atvr: vertices transformed per referenced vertex (1 is ideal)
+struct VertexCacheStats {
+    unsigned int transformed = 0;
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+// What optimizeMesh did to one mesh
+struct MeshOptimizeStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    unsigned int clusters = 0;      // hard clusters found by optimizeVertexCache
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                                    unsigned int cacheSize = 16);
+
+// Tipsify (Sander et al. 2007): reorders triangles so that vertices are reused while they are still
+// in a cache of cacheSize entries. If clusters is given it receives the first triangle of every run
+// that starts without cache reuse, the hard boundaries optimizeOverdraw needs.
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount,
+                         unsigned int cacheSize = 16, std::vector<uint32_t> *clusters = nullptr);
+
+// Splits the clusters from optimizeVertexCache further wherever that costs at most `threshold`
+// times their ACMR, then orders clusters so that outward-facing ones come first. Those tend to
+// occlude the rest, cutting overdraw from any viewpoint while keeping most of the cache gain.
+void optimizeOverdraw(uint32_t *indices, size_t indexCount, const Vertex *vertices, size_t vertexCount,
+                      const std::vector<uint32_t> &clusters, unsigned int cacheSize = 16,
+                      float threshold = 1.05f);
+
+// Renumbers vertices in the order the index buffer first uses them so fetches walk memory
+// linearly. Unreferenced vertices are dropped; returns the new vertex count.
+size_t optimizeVertexFetch(Vertex *vertices, size_t vertexCount, uint32_t *indices, size_t indexCount);
+
+// All three passes in order, as run on every mesh the engine uploads
+void optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices,
+                  MeshOptimizeStats *stats = nullptr, unsigned int cacheSize = 16);
+
+// Same for a LOD chain sharing one vertex array: indices holds every level back to back, level i
+// starting at lodStarts[i]. Triangles are reordered within each level, vertices for the whole
+// chain (in first use order of the finest level). stats describes the finest level.
+void optimizeMeshLods(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices,
+                      const std::vector<uint32_t> &lodStarts, MeshOptimizeStats *stats = nullptr,
+                      unsigned int cacheSize = 16);
+
+} // namespace Ygg
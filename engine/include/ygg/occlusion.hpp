@@ -0,0 +1,72 @@
+#pragma once
+#include "glm/glm.hpp"
+#include "ygg/job_system.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ygg {
+
+/*Software occlusion culling. Occluders are rasterised on the CPU into a small depth buffer (NDC
+depth in [0, 1], nearest wins) which is then reduced into a max-depth pyramid. An occludee is hidden
+when the nearest point of its bounds is behind the farthest occluder depth over the screen
+rectangle it covers; the pyramid keeps that to a handful of reads per object.
+
+The screen is split into tiles that are rasterised in parallel on a JobSystem, four pixels at a
+time with SSE.
+Nothing here touches GL.
+
+Per frame: beginFrame, add occluders, rasterize, then query.*/
+class OcclusionCuller {
+public:
+    // width is rounded up to a multiple of the 4 pixel SIMD width. Without jobs, tiles are
+    // rasterised on the calling thread
+    void init(uint32_t width = 256, uint32_t height = 128, JobSystem *jobs = nullptr);
+
+    // clears the depth buffer and the occluder list
+    void beginFrame(const glm::mat4 &viewProjection);
+
+    // triangles of an occluder mesh; positions are in the space model maps to world
+    void addOccluder(const glm::vec3 *positions, size_t vertexCount, const uint32_t *indices, size_t indexCount,
+                     const glm::mat4 &model);
+    // a solid box, the cheapest and most common occluder
+    void addOccluderBox(const glm::vec3 &min, const glm::vec3 &max, const glm::mat4 &model);
+
+    void rasterize();
+
+    // world-space queries, conservative: anything crossing the near plane counts as visible
+    bool isVisible(const glm::vec3 &min, const glm::vec3 &max) const;
+    bool isSphereVisible(const glm::vec4 &sphere) const;
+
+    size_t getOccluderTriangles() const { return triangles.size(); }
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+    // level 0 is the full resolution depth buffer, each further level halves both sides
+    const float* getDepth(unsigned int level = 0) const { return levels[level].data(); }
+    unsigned int getLevelCount() const { return static_cast<unsigned int>(levels.size()); }
+
+private:
+    // in pixels, z in NDC depth [0, 1]
+    struct ScreenTriangle {
+        glm::vec3 v[3];
+    };
+
+    void addClipTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c);
+    void rasterizeTile(uint32_t tile);
+    void buildPyramid();
+
+    static constexpr uint32_t TileWidth = 64;
+    static constexpr uint32_t TileHeight = 32;
+
+    uint32_t width = 0, height = 0;
+    uint32_t tilesX = 0, tilesY = 0;
+    JobSystem *jobs = nullptr;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<uint32_t>> bins;        // per tile, indices into triangles
+    std::vector<std::vector<float>> levels;         // max-depth pyramid, levels[0] is the raster target
+    std::vector<glm::uvec2> levelSizes;
+};
+
+} // namespace Ygg
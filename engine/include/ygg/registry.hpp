@@ -0,0 +1,160 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace Ygg {
+
+// Low 24 bits index, high 8 bits generation, so a stale Entity kept after destroy() doesn't match
+// the entity that reuses its index. 0 is never a valid entity
+using Entity = uint32_t;
+
+inline uint32_t entityIndex(Entity entity) { return entity & 0xFFFFFF; }
+
+/*Sparse set: components of one type packed in a dense array, with a sparse entity index -> dense
+position table. Iterating data() walks contiguous memory; removal swaps with the last element, so
+the dense order is arbitrary unless sortAs() imposes one.*/
+template <typename T>
+class ComponentPool {
+public:
+    bool has(Entity entity) const {
+        uint32_t index = entityIndex(entity);
+        return index < sparse.size() && sparse[index] != Absent && dense[sparse[index]] == entity;
+    }
+
+    T& add(Entity entity, T value) {
+        if (has(entity)) return components[sparse[entityIndex(entity)]] = std::move(value);
+        uint32_t index = entityIndex(entity);
+        if (index >= sparse.size()) sparse.resize(index + 1, Absent);
+        sparse[index] = static_cast<uint32_t>(dense.size());
+        dense.push_back(entity);
+        components.push_back(std::move(value));
+        return components.back();
+    }
+
+    void remove(Entity entity) {
+        if (!has(entity)) return;
+        uint32_t position = sparse[entityIndex(entity)];
+        uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+        if (position != last) {
+            dense[position] = dense[last];
+            components[position] = std::move(components[last]);
+            sparse[entityIndex(dense[position])] = position;
+        }
+        dense.pop_back();
+        components.pop_back();
+        sparse[entityIndex(entity)] = Absent;
+    }
+
+    // the entity must have the component
+    T& get(Entity entity) { return components[sparse[entityIndex(entity)]]; }
+    const T& get(Entity entity) const { return components[sparse[entityIndex(entity)]]; }
+    T* tryGet(Entity entity) { return has(entity) ? &get(entity) : nullptr; }
+
+    // component for the entity at position of a pool sorted the same way, falling back to a lookup
+    T* at(size_t position, Entity entity) {
+        if (position < dense.size() && dense[position] == entity) return &components[position];
+        return tryGet(entity);
+    }
+
+    size_t size() const { return dense.size(); }
+    T* data() { return components.data(); }
+    const T* data() const { return components.data(); }
+    const Entity* entities() const { return dense.data(); }
+
+    // moves the entities this pool shares with other to the front, in other's order, so that a
+    // loop over other finds their components at the same positions here
+    template <typename U>
+    void sortAs(const ComponentPool<U> &other) {
+        uint32_t next = 0;
+        for (size_t i = 0; i < other.size(); i++) {
+            Entity entity = other.entities()[i];
+            if (!has(entity)) continue;
+            uint32_t position = sparse[entityIndex(entity)];
+            if (position != next) {
+                std::swap(dense[position], dense[next]);
+                std::swap(components[position], components[next]);
+                sparse[entityIndex(dense[position])] = position;
+                sparse[entityIndex(dense[next])] = next;
+            }
+            next++;
+        }
+    }
+
+private:
+    static constexpr uint32_t Absent = ~0u;
+
+    std::vector<uint32_t> sparse;
+    std::vector<Entity> dense;
+    std::vector<T> components;
+};
+
+// Entities and one ComponentPool per component type. structureVersion() changes whenever a
+// component is added to or removed from any entity, so systems can tell when to re-sort pools.
+template <typename... Components>
+class Registry {
+public:
+    Entity create() {
+        uint32_t index;
+        if (!freeIndices.empty()) {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        } else {
+            // index 0 stays unused so that no entity is 0
+            if (generations.empty()) generations.push_back(0);
+            index = static_cast<uint32_t>(generations.size());
+            generations.push_back(0);
+        }
+        alive++;
+        return index | (uint32_t(generations[index]) << 24);
+    }
+
+    void destroy(Entity entity) {
+        if (!isAlive(entity)) return;
+        (pool<Components>().remove(entity), ...);
+        uint32_t index = entityIndex(entity);
+        generations[index]++;
+        freeIndices.push_back(index);
+        alive--;
+        version++;
+    }
+
+    bool isAlive(Entity entity) const {
+        uint32_t index = entityIndex(entity);
+        // destroy() bumps the generation, so freed indices never match
+        return entity != 0 && index < generations.size() && generations[index] == (entity >> 24);
+    }
+
+    template <typename T>
+    T& add(Entity entity, T value = T()) {
+        if (!pool<T>().has(entity)) version++;
+        return pool<T>().add(entity, std::move(value));
+    }
+
+    template <typename T>
+    void remove(Entity entity) {
+        if (pool<T>().has(entity)) version++;
+        pool<T>().remove(entity);
+    }
+
+    template <typename T> bool has(Entity entity) const { return pool<T>().has(entity); }
+    template <typename T> T& get(Entity entity) { return pool<T>().get(entity); }
+    template <typename T> T* tryGet(Entity entity) { return pool<T>().tryGet(entity); }
+
+    template <typename T> ComponentPool<T>& pool() { return std::get<ComponentPool<T>>(pools); }
+    template <typename T> const ComponentPool<T>& pool() const { return std::get<ComponentPool<T>>(pools); }
+
+    size_t size() const { return alive; }
+    uint64_t structureVersion() const { return version; }
+
+private:
+    std::tuple<ComponentPool<Components>...> pools;
+    std::vector<uint8_t> generations;
+    std::vector<uint32_t> freeIndices;
+    size_t alive = 0;
+    uint64_t version = 0;
+};
+
+} // namespace Ygg
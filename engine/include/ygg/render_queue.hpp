@@ -0,0 +1,218 @@
+#pragma once
+#include "glad/glad.h"
+#include "utils/shader.hpp"
+#include "ygg/transform.hpp"
+#include "ygg/geometry_pool.hpp"
+#include "ygg/stream_buffer.hpp"
+#include "ygg/culling.hpp"
+#include "ygg/occlusion.hpp"
+#include "ygg/lod.hpp"
+#include "ygg/job_system.hpp"
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Ygg {
+
+struct Mesh;
+
+// Handles for the per-draw uniforms of the engine's lit shaders, resolved once per program.
+// Per-frame values live in the FrameData/LightData uniform blocks instead (see frame_data.hpp)
+struct StandardUniforms {
+    UniformHandle model;
+    UniformHandle normalMatrix;
+    UniformHandle objectColor;
+
+    void resolve(const Shader &program);
+};
+
+// Points the instance attributes (3-10) of the bound VAO at InstanceData records in buffer,
+// starting at byte offset. Re-pointing the offset is how a run of instances is based at an
+// arbitrary record without GL 4.2 base-instance draws.
+void bindInstanceAttributes(GLuint buffer, GLintptr offset);
+
+// Immediate issues one draw per packet with per-draw uniforms. Batched streams every packet's
+// InstanceData once and draws each run of packets sharing program and geometry with a single
+// instanced call, so submission cost follows the number of distinct meshes, not objects.
+enum class SubmitMode { Immediate, Batched };
+
+// One queued draw. The sort key orders packets as program | VAO | geometry | LOD | material | depth
+struct DrawPacket {
+    uint64_t key;
+    Shader *program;
+    Shader *instancedProgram;   // instanced variant of program, used in batched mode (may be null)
+    GLuint VAO;
+    GLsizei indexCount;
+    GLenum indexType;       // GL_UNSIGNED_BYTE/SHORT/INT
+    GLint baseVertex;
+    uint32_t indexOffset;   // bytes into the VAO's element buffer
+    uint32_t transform;     // index into the queue's model/normal matrix/colour arrays
+};
+
+// Work done by the last flush, to compare against immediate-mode drawing
+struct RenderQueueStats {
+    unsigned int objects = 0;       // drawn, after culling
+    unsigned int culled = 0;        // submitted but outside the frustum
+    unsigned int occluded = 0;      // inside the frustum but hidden behind occluders
+    unsigned int drawCalls = 0;
+    unsigned int programBinds = 0;
+    unsigned int vaoBinds = 0;
+};
+
+// Stable LSD radix sort of keys, carrying order along (order[i] belongs to keys[i]). The scratch
+// vectors are resized to match and keep their capacity between calls
+void radixSortKeys(std::vector<uint64_t> &keys, std::vector<uint32_t> &order,
+                   std::vector<uint64_t> &keysScratch, std::vector<uint32_t> &orderScratch);
+
+class RenderQueue;
+
+/*Packets recorded by one thread. push() only reads the queue's frame state and writes the
+recorder's own arrays, so any number of recorders can be filled at once; flush() merges them on
+the GL thread. Program slots are numbered per recorder and LOD state lives with the caller's
+objects, so nothing shared is written while recording.*/
+class DrawRecorder {
+public:
+    // as RenderQueue::push
+    void push(Shader &program, Shader *instancedProgram, const Mesh &mesh, const GeometryRange &range,
+              const glm::mat4 &model, const glm::vec3 &color, const glm::vec4 &sphere, uint16_t material = 0,
+              uint8_t *lodState = nullptr);
+
+    size_t size() const { return packets.size(); }
+
+private:
+    friend class RenderQueue;
+    explicit DrawRecorder(const RenderQueue &queue) : queue(queue) {}
+    void clear();
+
+    const RenderQueue &queue;
+    std::vector<DrawPacket> packets;
+    std::vector<glm::mat4> models;
+    std::vector<glm::vec3> colors;
+    // bounding spheres as separate arrays for the SIMD cull
+    std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+    std::vector<uint8_t> visible;
+    // the top byte of a recorded key indexes programs; flush swaps in the queue-wide slot
+    std::vector<GLuint> programs;
+    std::vector<uint8_t> slots;
+};
+
+/*Collects the draws for a frame, sorts them by state and submits them skipping redundant binds.
+Packets are only valid between begin() and flush(). The frame uniform blocks must already be
+up to date when flush() runs.
+
+Recording (LOD selection, sort keys) can run on any thread through record(); flush() culls, merges
+and packs instance data on the job system and only issues the GL calls on the calling thread.*/
+class RenderQueue {
+public:
+    RenderQueue() : direct(*this) {}
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // view gives the depth part of the sort keys; projection * view the culling frustum
+    void begin(const glm::mat4 &view, const glm::mat4 &projection);
+
+    // material is a user-defined id (low 12 bits take part in sorting); draws with equal ids end
+    // up adjacent within a program/geometry run. range is the mesh's current place in its geometry pool,
+    // sphere its world-space bounding sphere (xyz centre, w radius). Meshes with a LOD chain are drawn
+    // at the level selected from the sphere's distance and size. lodState, if given, is the object's
+    // level from last frame for hysteresis and receives the new one; each object needs its own, as
+    // meshes are shared
+    void push(Shader &program, Shader *instancedProgram, const Mesh &mesh, const GeometryRange &range,
+              const glm::mat4 &model, const glm::vec3 &color, const glm::vec4 &sphere, uint16_t material = 0,
+              uint8_t *lodState = nullptr);
+
+    // body(recorder, begin, end) over [0, count) in chunks of grain items, spread over the job
+    // system; every chunk records into a recorder of its own. Returns when all chunks are recorded.
+    // Call from the thread that owns the queue, between begin() and flush()
+    void record(size_t count, size_t grain, const std::function<void(DrawRecorder&, size_t, size_t)> &body);
+
+    // merges and sorts the packets and issues the GL calls; must run on the context thread
+    void flush();
+    void destroy();
+    // takes effect from the next begin()
+    void setSubmitMode(SubmitMode mode) { submitMode = mode; }
+    SubmitMode getSubmitMode() const { return submitMode; }
+
+    // frustum culling of the pushed spheres at flush, on by default
+    void setCulling(bool enabled) { culling = enabled; }
+    bool getCulling() const { return culling; }
+    // LOD selection: error budget in pixels, hysteresis as in selectLod, and the viewport height the
+    // projection maps to
+    void setLodBudget(float budgetPixels, float hysteresis, float viewportHeight) {
+        lodBudget = budgetPixels;
+        lodHysteresis = hysteresis;
+        lodViewportHeight = viewportHeight;
+    }
+    // record() and the per-packet passes of flush run on these workers; null keeps everything on
+    // the calling thread
+    void setJobSystem(JobSystem *jobSystem) { jobs = jobSystem; }
+    // a rasterized occlusion buffer to test frustum survivors against at the next flush, or null
+    void setOcclusion(const OcclusionCuller *culler) { occlusion = culler; }
+
+    // packets recorded since begin()
+    size_t size() const;
+    const RenderQueueStats& getStats() const { return stats; }
+
+private:
+    friend class DrawRecorder;
+
+    // a contiguous piece of one recorder, the unit of the parallel passes of flush
+    struct MergeTask {
+        DrawRecorder *recorder;
+        uint32_t begin, end;
+        uint32_t culled, occluded;
+        uint32_t output;        // first merged index
+    };
+
+    static uint64_t makeKey(uint8_t programSlot, GLuint VAO, GeometryHandle geometry, unsigned int lod,
+                            uint16_t material, float depth);
+    uint8_t programSlot(GLuint program);
+    void reset();
+    // culls every recorder and gathers the survivors into the arrays below
+    void merge();
+    void cull(MergeTask &task) const;
+    void sortKeys();
+    void submitImmediate();
+    void submitBatched();
+    // instance data for every packet, in order; false if the stream can't be mapped
+    bool uploadInstances(GLintptr &base);
+    void forEach(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body);
+
+    SubmitMode submitMode = SubmitMode::Batched;
+    glm::mat4 view = glm::mat4(1.0f);
+    float projectionY = 1.0f;
+    float lodBudget = 1.0f;
+    float lodHysteresis = 0.25f;
+    float lodViewportHeight = 600.0f;
+    Frustum frustum;
+    bool culling = true;
+    const OcclusionCuller *occlusion = nullptr;
+    JobSystem *jobs = nullptr;
+
+    // push() records here; record() hands out the others, reused from frame to frame
+    DrawRecorder direct;
+    std::vector<std::unique_ptr<DrawRecorder>> recorders;
+    size_t recordersUsed = 0;
+    std::vector<MergeTask> tasks;
+
+    // merged, culled packets; packet i owns transform i
+    std::vector<DrawPacket> packets;
+    // kept apart from the packets so the normal matrices can be computed in one SIMD batch
+    std::vector<glm::mat4> models;
+    std::vector<NormalMatrix> normals;
+    std::vector<glm::vec3> colors;
+    std::vector<GLuint> programs;      // slot -> program ID, rebuilt every frame
+
+    // radix sort works on (key, packet index) pairs so the large packets are never moved
+    std::vector<uint64_t> keys, keysScratch;
+    std::vector<uint32_t> order, orderScratch;
+
+    // batched mode: per-draw records in sorted order, streamed once per flush
+    StreamBuffer instanceStream;
+
+    RenderQueueStats stats;
+};
+
+} // namespace Ygg
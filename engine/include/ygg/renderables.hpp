@@ -0,0 +1,81 @@
+#pragma once
+#include "ygg/registry.hpp"
+#include "ygg/scene_graph.hpp"
+#include "ygg/bvh.hpp"
+#include "ygg/culling.hpp"
+#include "ygg/job_system.hpp"
+#include "glm/glm.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace Ygg {
+
+struct Mesh;
+class RenderEngine;
+
+// Components of a renderable entity. Transform, MeshRef and Visibility make an entity drawable;
+// the systems below add WorldBounds, and Material where missing.
+struct Transform {
+    glm::mat4 model = glm::mat4(1.0f);
+};
+
+// Transform.model follows this scene graph node: world(node) * offset
+struct SceneNode {
+    NodeHandle node = 0;
+    glm::mat4 offset = glm::mat4(1.0f);
+};
+
+// the mesh must outlive the component; meshes are small handles into shared geometry, so many
+// entities point at the same one. lod is this entity's LOD hysteresis state (see submitMesh)
+struct MeshRef {
+    const Mesh *mesh = nullptr;
+    uint8_t lod = 0;
+};
+
+// color replaces the mesh's colour; id is the render queue material (low 12 bits sort)
+struct Material {
+    glm::vec3 color = glm::vec3(1.0f);
+    uint16_t id = 0;
+};
+
+// world-space bounds and the entity's box in the culling BVH
+struct WorldBounds {
+    glm::vec4 sphere = glm::vec4(0.0f);
+    glm::vec3 min = glm::vec3(0.0f), max = glm::vec3(0.0f);
+    int32_t proxy = DynamicBvh::NullNode;
+};
+
+// hidden is the user's switch; visible is the result of the last cull
+struct Visibility {
+    bool hidden = false;
+    bool visible = true;
+};
+
+using RenderRegistry = Registry<Transform, SceneNode, MeshRef, Material, WorldBounds, Visibility>;
+
+/*Per-frame systems, in order. Each walks the dense MeshRef (or SceneNode) array and finds the other
+components of an entity at the same position once packRenderables has sorted the pools alike.*/
+
+// sorts every pool in MeshRef order; only does work after components were added or removed
+void packRenderables(RenderRegistry &registry);
+// Transform.model from the scene graph for entities with a SceneNode (run scene.update() first)
+void updateTransforms(RenderRegistry &registry, const SceneGraph &scene, JobSystem *jobs = nullptr);
+// WorldBounds from the mesh bounds and Transform, and their boxes in bvh (userData is the entity).
+// The bounds are computed on jobs, the BVH is updated on the calling thread
+void updateBounds(RenderRegistry &registry, DynamicBvh &bvh, JobSystem *jobs = nullptr);
+// Visibility.visible for every renderable from the BVH; returns how many are visible
+size_t cullRenderables(RenderRegistry &registry, const DynamicBvh &bvh, const Frustum &frustum,
+                       std::vector<uint32_t> &scratch);
+// The nearest unhidden renderable whose world box the ray hits within maxDistance (distances in
+// units of direction's length), or 0. Leaves are found in the BVH, then tested against the exact box
+Entity pickRenderable(RenderRegistry &registry, const DynamicBvh &bvh, const glm::vec3 &origin,
+                      const glm::vec3 &direction, float maxDistance, float *distance = nullptr);
+// every renderable whose world box overlaps region, appended to out
+void queryRenderables(RenderRegistry &registry, const DynamicBvh &bvh, const Aabb &region, std::vector<Entity> &out);
+// submits every visible, unhidden renderable to the engine's render queue
+void buildDrawList(RenderRegistry &registry, RenderEngine &engine);
+
+// removes the entity's box from bvh before destroying it
+void destroyRenderable(RenderRegistry &registry, DynamicBvh &bvh, Entity entity);
+
+} // namespace Ygg
@@ -0,0 +1,74 @@
+#pragma once
+#include "glm/glm.hpp"
+#include "ygg/job_system.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ygg {
+
+// 0 is never a valid handle
+using NodeHandle = uint32_t;
+
+/*Transform hierarchy. Nodes are stored flat in depth-first order, structure of arrays: a parent
+always comes before its children and every subtree is one contiguous range. setLocal only records
+the node as dirty; update() then recomputes world = parent world * local over the dirty subtrees
+alone, so animating a few characters out of thousands costs what those characters cost.
+
+Structural edits (create under a parent whose subtree isn't the last one, setParent, destroy) mark
+the order stale; the next update() rebuilds it in one pass and recomputes every world transform.
+Creating a hierarchy parent first, depth first, keeps the order valid and skips that rebuild.
+
+Handles stay valid across rebuilds. Indices (getIndex, worldData) only until the next update().*/
+class SceneGraph {
+public:
+    // parent 0 creates a root
+    NodeHandle create(NodeHandle parent = 0, const glm::mat4 &local = glm::mat4(1.0f));
+    // destroys node and everything below it
+    void destroy(NodeHandle node);
+    // moves node (with its subtree) under parent, or makes it a root for 0. Returns false, and
+    // leaves the graph as it was, if parent is node itself or one of its descendants
+    bool setParent(NodeHandle node, NodeHandle parent);
+
+    void setLocal(NodeHandle node, const glm::mat4 &local);
+    const glm::mat4& getLocal(NodeHandle node) const { return locals[slots[node]]; }
+    // as of the last update()
+    const glm::mat4& getWorld(NodeHandle node) const { return worlds[slots[node]]; }
+    NodeHandle getParent(NodeHandle node) const { return parents[node]; }
+    bool isAlive(NodeHandle node) const { return node < slots.size() && slots[node] != Dead; }
+
+    // recomputes the world transforms of dirty subtrees; returns how many were recomputed.
+    // Disjoint subtrees are independent, so with jobs they are spread over the workers
+    size_t update(JobSystem *jobs = nullptr);
+
+    // the flat arrays, in depth-first order
+    size_t size() const { return order.size(); }
+    uint32_t getIndex(NodeHandle node) const { return slots[node]; }
+    const glm::mat4* worldData() const { return worlds.data(); }
+    const NodeHandle* handleData() const { return order.data(); }
+
+private:
+    static constexpr uint32_t Dead = ~0u;
+    static constexpr uint32_t NoParent = ~0u;
+
+    void relayout();
+    void markDirty(NodeHandle node);
+
+    // per handle
+    std::vector<uint32_t> slots;            // handle -> index, Dead if free
+    std::vector<NodeHandle> parents;
+    std::vector<uint8_t> dirty;
+    std::vector<NodeHandle> freeHandles;
+
+    // per index, depth-first
+    std::vector<NodeHandle> order;
+    std::vector<uint32_t> parentIndex;      // NoParent for roots
+    std::vector<uint32_t> subtreeEnd;       // one past the node's last descendant
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+
+    std::vector<NodeHandle> dirtyNodes;
+    bool layoutStale = false;
+};
+
+} // namespace Ygg
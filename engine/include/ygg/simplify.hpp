@@ -0,0 +1,69 @@
+#pragma once
+#include "ygg/vertex_layout.hpp"
+#include "ygg/lod.hpp"
+#include "ygg/job_system.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ygg {
+
+// How attributes weigh against geometry. Positions are measured relative to the mesh's largest
+// extent, normals and colours as they are, so a weight of 1 makes a normal turning 90 degrees cost
+// about as much as moving a vertex across the whole mesh.
+struct SimplifyOptions {
+    float normalWeight = 0.5f;
+    float colorWeight = 0.5f;
+    // open boundaries stay fixed; otherwise border vertices may only slide along the border
+    bool lockBorder = true;
+};
+
+/*Quadric error simplification (Garland and Heckbert 1997). Edges are collapsed onto one of their
+existing vertices, cheapest first, so the vertex buffer stays as it is and only a new index buffer
+is written. Each vertex accumulates the planes of its triangles plus an area weighted average of
+its normal and colour, and a collapse costs the distance to those planes and the drift of those
+attributes. Collapses that flip a triangle or make the surface non-manifold are rejected.
+
+Vertices split by an attribute seam (same position, different normal or colour) are never moved,
+so seams keep their shape. Duplicates that are identical in every attribute are merged first.
+
+Stops once the index count is at most targetIndexCount, or when the next collapse would move the
+surface by more than targetError (in the mesh's units). Returns the index count written to
+destination, which may alias indices. resultError receives the largest error taken on.*/
+size_t simplifyMesh(uint32_t *destination, const uint32_t *indices, size_t indexCount,
+                    const Vertex *vertices, size_t vertexCount, size_t targetIndexCount, float targetError,
+                    float *resultError = nullptr, const SimplifyOptions &options = SimplifyOptions());
+
+struct LodChainOptions {
+    unsigned int maxLods = MAX_MESH_LODS;
+    float reduction = 0.5f;         // triangle ratio between consecutive levels
+    float maxError = 0.1f;          // no levels coarser than this, as a fraction of the mesh's extent
+    SimplifyOptions simplify;
+};
+
+// LOD levels over one vertex array, finest (the input) first, with errors in the mesh's units:
+// ready for RenderEngine::createMesh(vertices, chain.indices, chain.errors)
+struct LodChain {
+    std::vector<std::vector<uint32_t>> indices;
+    std::vector<float> errors;
+};
+
+// Every level is simplified from the full mesh, so its error is measured against the original.
+// The chain ends early once a level no longer removes much or would exceed maxError.
+LodChain generateLodChain(const Vertex *vertices, size_t vertexCount, const uint32_t *indices, size_t indexCount,
+                          const LodChainOptions &options = LodChainOptions());
+
+struct LodSource {
+    const Vertex *vertices;
+    size_t vertexCount;
+    const uint32_t *indices;
+    size_t indexCount;
+};
+
+// generateLodChain for many meshes, one job each (all on the calling thread without jobs); chains
+// are returned in the order of meshes
+std::vector<LodChain> generateLodChains(const std::vector<LodSource> &meshes,
+                                        const LodChainOptions &options = LodChainOptions(),
+                                        JobSystem *jobs = nullptr);
+
+} // namespace Ygg
@@ -0,0 +1,44 @@
+#pragma once
+#include "glad/glad.h"
+#include <cstddef>
+#include <vector>
+
+namespace Ygg {
+
+/*Streams per-frame data through glMapBufferRange(GL_MAP_UNSYNCHRONIZED_BIT) without ever stalling
+in the driver. The buffer is split into `regions` equal regions, one per frame in flight. Every
+region gets a fence when it is left, and is only written again once that fence has signalled,
+which normally happened long ago.
+
+Ranges returned by map() stay valid until the ring comes back around, so callers must (re)bind
+what they wrote before their next draw; they must not hold on to an offset across frames.*/
+class StreamBuffer {
+public:
+    void init(GLenum target, size_t regionSize, unsigned int regions = 3);
+    void destroy();
+
+    // Reserves `size` bytes aligned to `alignment` and maps them for writing. The buffer is left
+    // bound to its target. If the current region is full the ring moves on to the next one; a
+    // request bigger than a whole region grows the buffer.
+    void* map(size_t size, size_t alignment, GLintptr &offset);
+    void unmap();
+
+    // fences the region used this frame and moves to the next one; call once per frame
+    void endFrame();
+
+    GLuint buffer() const { return id; }
+    bool isInitialized() const { return id != 0; }
+
+private:
+    void advance();
+    void grow(size_t minRegionSize);
+
+    GLenum target = GL_ARRAY_BUFFER;
+    GLuint id = 0;
+    size_t regionSize = 0;
+    unsigned int region = 0;
+    size_t cursor = 0;               // bytes used in the current region
+    std::vector<GLsync> fences;      // one per region, 0 when the GPU holds no reference to it
+};
+
+} // namespace Ygg
@@ -0,0 +1,128 @@
+#pragma once
+#include "glad/glad.h"
+#include "ygg/stream_buffer.hpp"
+#include "ygg/job_system.hpp"
+#include "ygg/block_compress.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Ygg {
+
+// 0 is never a valid handle
+using TextureHandle = uint32_t;
+
+enum class TextureState : uint8_t { Loading, Ready, Failed };
+
+struct TextureOptions {
+    bool mipmaps = true;
+    bool srgb = false;      // colour textures; leave off for data like normal maps
+    bool flipY = true;      // first row at the bottom, as GL expects
+    // block compress on the worker after decoding, mipmaps included (they are built on the CPU
+    // since GL can't generate them for compressed formats). Falls back to RGBA8 when the driver
+    // lacks the format; see supportsCompression
+    bool compress = false;
+    BlockFormat blockFormat = BlockFormat::BC1;
+    CompressQuality compressQuality = CompressQuality::Fast;
+};
+
+/*Loads textures without stalling frames. load() returns a handle at once that is bound to a 1x1
+white placeholder: the file is read and decoded (stb_image, always to RGBA8) on the job system,
+and update() then streams the pixels to the GPU on the GL thread through a pixel unpack buffer.
+Each update() copies at most the upload budget, in bands of rows, so a large texture is spread over
+several frames instead of blocking one. Once every row is in, the mipmaps are generated and get()
+switches from the placeholder to the texture.
+
+Textures that fail to load keep the placeholder and report Failed. The engine owns one manager
+and calls update() from beginFrame.*/
+class TextureManager {
+public:
+    // jobs may be null, then load() decodes on the calling thread
+    void init(JobSystem *jobs, size_t uploadBudget = 4 << 20);
+    // waits for decodes still running, then deletes every texture
+    void destroy();
+
+    TextureHandle load(const std::string &path, const TextureOptions &options = TextureOptions());
+    // deletes the texture; a decode still in flight is dropped when it finishes
+    void release(TextureHandle handle);
+
+    // the texture to sample for handle right now: the placeholder until it is Ready
+    GLuint get(TextureHandle handle) const;
+    void bind(TextureHandle handle, unsigned int unit) const;
+    // Failed for handles that were never loaded or outlived destroy()
+    TextureState getState(TextureHandle handle) const {
+        return handle < slots.size() ? slots[handle].state : TextureState::Failed;
+    }
+    // 0 until decoded
+    unsigned int getWidth(TextureHandle handle) const { return handle < slots.size() ? slots[handle].width : 0; }
+    unsigned int getHeight(TextureHandle handle) const { return handle < slots.size() ? slots[handle].height : 0; }
+
+    // BC1/BC3 need EXT_texture_compression_s3tc (and EXT_texture_sRGB for sRGB); BC4/BC5 are core
+    bool supportsCompression(BlockFormat format, bool srgb = false) const;
+
+    // bytes of pixels copied per update(); at least one row band always goes per frame
+    void setUploadBudget(size_t bytes) { uploadBudget = bytes; }
+    // pixels decoded but not uploaded yet
+    size_t getPendingBytes() const;
+
+    // uploads decoded images within the budget; GL thread only, once per frame
+    void update();
+
+private:
+    struct Slot {
+        GLuint texture = 0;
+        unsigned int width = 0, height = 0;
+        TextureState state = TextureState::Failed;
+        TextureOptions options;
+        bool alive = false;
+        uint32_t generation = 0;    // bumped on release, so late decodes of a reused slot are dropped
+    };
+
+    struct CompressedLevel {
+        size_t offset;              // into Image::blocks
+        unsigned int width, height;
+    };
+
+    // a decoded image, handed from the decoding job to update()
+    struct Image {
+        TextureHandle handle;
+        uint32_t generation;
+        unsigned char *pixels;      // stb_image allocation, RGBA8; null if decoding failed or compressed
+        unsigned int width, height;
+        unsigned int rowsUploaded;  // of pixels, or of blocks in the current level when compressed
+        // compressed images: every level's blocks, finest first
+        std::vector<uint8_t> blocks = {};
+        std::vector<CompressedLevel> levels = {};
+        unsigned int level = 0;
+    };
+
+    void decode(TextureHandle handle, uint32_t generation, const std::string &path, const TextureOptions &options);
+    static void compress(Image &image, const TextureOptions &options, JobSystem *jobs);
+    static bool uploaded(const Image &image);
+    // uploads up to budget bytes of image (at least one band when forced); returns the bytes copied
+    size_t upload(Image &image, size_t budget, bool force);
+    size_t uploadCompressed(Image &image, size_t budget, bool force);
+    void finish(const Image &image);
+    static void freePixels(Image &image);
+
+    JobSystem *jobs = nullptr;
+    size_t uploadBudget = 4 << 20;
+    GLuint placeholder = 0;
+    bool s3tc = false, s3tcSrgb = false;
+    StreamBuffer pixelStream;
+
+    std::vector<Slot> slots;                // indexed by handle, slot 0 unused
+    std::vector<TextureHandle> freeHandles;
+
+    // decoded on the workers, picked up by update()
+    JobCounter decodes;
+    mutable std::mutex decodedLock;
+    std::vector<Image> decoded;
+    // uploading, oldest first
+    std::deque<Image> uploads;
+};
+
+} // namespace Ygg
@@ -0,0 +1,42 @@
+#pragma once
+#include "glm/glm.hpp"
+#include <cstddef>
+
+namespace Ygg {
+
+// Inverse-transpose of the upper 3x3 of a model matrix. Columns are padded to vec4 so batches
+// can be written with plain SIMD stores; the shader only reads xyz.
+struct NormalMatrix {
+    glm::vec4 columns[3];
+
+    glm::mat3 toMat3() const {
+        return glm::mat3(glm::vec3(columns[0]), glm::vec3(columns[1]), glm::vec3(columns[2]));
+    }
+};
+
+// Per-instance record for instanced draws: model at attribute locations 3-6, normal matrix at 7-9,
+// colour at 10
+struct InstanceData {
+    glm::mat4 model;
+    NormalMatrix normal;
+    glm::vec4 color;
+};
+
+static_assert(sizeof(NormalMatrix) == 48, "NormalMatrix is uploaded as three vec4 columns");
+static_assert(sizeof(InstanceData) == 128, "InstanceData layout is mirrored by the instance attributes");
+
+// Single object. Rigid and uniformly scaled transforms skip the cofactor computation.
+NormalMatrix computeNormalMatrix(const glm::mat4 &model);
+
+// Batched version, four matrices per SSE iteration. Branch-free, so every transform takes the general
+// path; that is still cheaper than testing each lane for the rigid case.
+void computeNormalMatrices(const glm::mat4 *models, size_t count, NormalMatrix *out);
+
+// a * b, four columns at a time with SSE where available
+glm::mat4 multiplyTransform(const glm::mat4 &a, const glm::mat4 &b);
+
+// Copies the models and fills in their normal matrices, ready for the instance buffer. Colours are
+// left to the caller
+void packInstanceData(const glm::mat4 *models, size_t count, InstanceData *out);
+
+} // namespace Ygg
@@ -0,0 +1,72 @@
+#pragma once
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace Ygg {
+
+// Full precision vertex that meshes are built from; the pool stores it in one of the VertexFormats
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 normal;
+    glm::vec3 color;
+};
+
+// How vertices are stored on the GPU. Every format feeds the same shader inputs: position at 0,
+// normal at 1, colour at 2.
+//   Standard          36 bytes, all float
+//   Compact           20 bytes, float position, 2_10_10_10 normal, RGBA8 colour
+//   CompactHalf       16 bytes, half float position
+//   CompactQuantized  16 bytes, snorm16 position inside the mesh bounds; needs the mesh dequantize
+enum class VertexFormat : uint8_t { Standard, Compact, CompactHalf, CompactQuantized };
+constexpr unsigned int VERTEX_FORMAT_COUNT = 4;
+
+struct CompactVertex {
+    glm::vec3 pos;
+    uint32_t normal;    // GL_INT_2_10_10_10_REV, normalised
+    uint32_t color;     // RGBA8, normalised
+};
+
+// pos holds half floats or snorm16 depending on the format; the fourth component is padding
+struct PackedVertex {
+    uint16_t pos[4];
+    uint32_t normal;
+    uint32_t color;
+};
+
+static_assert(sizeof(Vertex) == 36, "Vertex is uploaded as-is for VertexFormat::Standard");
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex layout is mirrored by its VertexLayout");
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex layout is mirrored by its VertexLayout");
+
+struct VertexAttribute {
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    uint32_t offset;
+};
+
+// Attribute setup for one format; apply() points the bound VAO at the bound GL_ARRAY_BUFFER
+struct VertexLayout {
+    uint32_t stride;
+    VertexAttribute attributes[3];
+
+    void apply() const;
+};
+
+const VertexLayout& getVertexLayout(VertexFormat format);
+
+// Quantised positions are stored relative to the mesh bounds: pos = bias + scale * stored. The
+// scale is the same on every axis so the normal matrix only changes by a constant factor, which
+// the shader's normalize() removes. Stored as (bias, scale); identity is (0, 0, 0, 1).
+using Dequantize = glm::vec4;
+
+// Writes count vertices in `format` to dst, which must hold count * stride bytes, and returns the
+// transform that undoes the position encoding
+Dequantize encodeVertices(VertexFormat format, const Vertex *vertices, size_t count, void *dst);
+
+// model * translate(bias) * scale(scale), without the full matrix product
+glm::mat4 applyDequantize(const glm::mat4 &model, const Dequantize &dequantize);
+
+} // namespace Ygg
@@ -0,0 +1,470 @@
+#include "ygg/block_compress.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define YGG_BLOCK_SSE 1
+#endif
+
+namespace {
+
+using Ygg::BlockFormat;
+using Ygg::CompressQuality;
+
+// one block's colours, structure of arrays so four pixels are matched against the palette at once
+struct ColorBlock {
+    alignas(16) float r[16];
+    alignas(16) float g[16];
+    alignas(16) float b[16];
+};
+
+// the 16 pixels of block (bx, by); the edges repeat the last row/column of the image
+void loadBlock(const uint8_t *rgba, unsigned int width, unsigned int height, unsigned int bx, unsigned int by,
+               uint8_t pixels[16][4]) {
+    for (unsigned int y = 0; y < 4; y++) {
+        unsigned int sy = std::min(by * 4 + y, height - 1);
+        for (unsigned int x = 0; x < 4; x++) {
+            unsigned int sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(pixels[y * 4 + x], rgba + (size_t(sy) * width + sx) * 4, 4);
+        }
+    }
+}
+
+uint16_t pack565(const float c[3]) {
+    int r = std::min(std::max(int(c[0] * (31.0f / 255.0f) + 0.5f), 0), 31);
+    int g = std::min(std::max(int(c[1] * (63.0f / 255.0f) + 0.5f), 0), 63);
+    int b = std::min(std::max(int(c[2] * (31.0f / 255.0f) + 0.5f), 0), 31);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpack565(uint16_t v, int out[3]) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// the palette of the four-colour mode (c0 > c1)
+void colorPalette(uint16_t c0, uint16_t c1, float palette[4][3]) {
+    int a[3], b[3];
+    unpack565(c0, a);
+    unpack565(c1, b);
+    for (int c = 0; c < 3; c++) {
+        palette[0][c] = float(a[c]);
+        palette[1][c] = float(b[c]);
+        palette[2][c] = float((2 * a[c] + b[c]) / 3);
+        palette[3][c] = float((a[c] + 2 * b[c]) / 3);
+    }
+}
+
+// nearest palette entry for every pixel; returns the summed squared error
+float selectColorIndices(const ColorBlock &block, const float palette[4][3], uint8_t indices[16]) {
+#ifdef YGG_BLOCK_SSE
+    __m128 total = _mm_setzero_ps();
+    for (int i = 0; i < 16; i += 4) {
+        __m128 r = _mm_load_ps(block.r + i);
+        __m128 g = _mm_load_ps(block.g + i);
+        __m128 b = _mm_load_ps(block.b + i);
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128 bestIndex = _mm_setzero_ps();
+        for (int k = 0; k < 4; k++) {
+            __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[k][0]));
+            __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[k][1]));
+            __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[k][2]));
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+            __m128 closer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(float(k))), _mm_andnot_ps(closer, bestIndex));
+        }
+        total = _mm_add_ps(total, best);
+        alignas(16) float chosen[4];
+        _mm_store_ps(chosen, bestIndex);
+        for (int j = 0; j < 4; j++) indices[i + j] = static_cast<uint8_t>(chosen[j]);
+    }
+    alignas(16) float sums[4];
+    _mm_store_ps(sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float best = FLT_MAX;
+        for (int k = 0; k < 4; k++) {
+            float dr = block.r[i] - palette[k][0], dg = block.g[i] - palette[k][1], db = block.b[i] - palette[k][2];
+            float d = dr * dr + dg * dg + db * db;
+            if (d < best) {
+                best = d;
+                indices[i] = static_cast<uint8_t>(k);
+            }
+        }
+        total += best;
+    }
+    return total;
+#endif
+}
+
+struct ColorEncoding {
+    uint16_t c0, c1;
+    uint8_t indices[16];
+    float error;
+};
+
+// quantizes the endpoints, always in four-colour order, and picks the indices
+ColorEncoding encodeEndpoints(const ColorBlock &block, const float hi[3], const float lo[3]) {
+    ColorEncoding encoding;
+    encoding.c0 = pack565(hi);
+    encoding.c1 = pack565(lo);
+    if (encoding.c0 < encoding.c1) std::swap(encoding.c0, encoding.c1);
+    float palette[4][3];
+    colorPalette(encoding.c0, encoding.c1, palette);
+    encoding.error = selectColorIndices(block, palette, encoding.indices);
+    return encoding;
+}
+
+// endpoints that best reproduce the block with the given indices, by least squares
+bool refineEndpoints(const ColorBlock &block, const uint8_t indices[16], float hi[3], float lo[3]) {
+    // index -> weight of c0; c1 gets the rest
+    static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ap[3] = {}, bp[3] = {};
+    for (int i = 0; i < 16; i++) {
+        float a = weights[indices[i]], b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        const float p[3] = {block.r[i], block.g[i], block.b[i]};
+        for (int c = 0; c < 3; c++) {
+            ap[c] += a * p[c];
+            bp[c] += b * p[c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) return false;
+    float inv = 1.0f / det;
+    for (int c = 0; c < 3; c++) {
+        hi[c] = std::min(std::max((ap[c] * bb - bp[c] * ab) * inv, 0.0f), 255.0f);
+        lo[c] = std::min(std::max((bp[c] * aa - ap[c] * ab) * inv, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+void encodeColorBlock(const uint8_t pixels[16][4], CompressQuality quality, uint8_t *out) {
+    ColorBlock block;
+    float mean[3] = {}, lo[3] = {255.0f, 255.0f, 255.0f}, hi[3] = {};
+    for (int i = 0; i < 16; i++) {
+        block.r[i] = pixels[i][0];
+        block.g[i] = pixels[i][1];
+        block.b[i] = pixels[i][2];
+        const float p[3] = {block.r[i], block.g[i], block.b[i]};
+        for (int c = 0; c < 3; c++) {
+            mean[c] += p[c] / 16.0f;
+            lo[c] = std::min(lo[c], p[c]);
+            hi[c] = std::max(hi[c], p[c]);
+        }
+    }
+
+    // covariance of the colours
+    float cov[6] = {};
+    for (int i = 0; i < 16; i++) {
+        float r = block.r[i] - mean[0], g = block.g[i] - mean[1], b = block.b[i] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    if (quality == CompressQuality::Fast) {
+        // the bounding box diagonal that follows the colours, inset a little since the extremes
+        // rarely land on the quantized palette
+        int reference = cov[0] >= cov[3] && cov[0] >= cov[5] ? 0 : (cov[3] >= cov[5] ? 1 : 2);
+        const float correlation[3][3] = {{cov[0], cov[1], cov[2]}, {cov[1], cov[3], cov[4]}, {cov[2], cov[4], cov[5]}};
+        for (int c = 0; c < 3; c++) {
+            if (correlation[reference][c] < 0.0f) std::swap(lo[c], hi[c]);
+            float inset = (hi[c] - lo[c]) / 16.0f;
+            lo[c] += inset;
+            hi[c] -= inset;
+        }
+    } else {
+        // principal axis by power iteration, starting from the box diagonal
+        float axis[3] = {hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]};
+        for (int iteration = 0; iteration < 8; iteration++) {
+            float next[3] = {
+                cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+                cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+                cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2],
+            };
+            float length = std::max(std::fabs(next[0]), std::max(std::fabs(next[1]), std::fabs(next[2])));
+            if (length < 1e-6f) break;
+            for (int c = 0; c < 3; c++) axis[c] = next[c] / length;
+        }
+        float length2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        if (length2 > 1e-12f) {
+            float tMin = FLT_MAX, tMax = -FLT_MAX;
+            for (int i = 0; i < 16; i++) {
+                float t = ((block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1] +
+                           (block.b[i] - mean[2]) * axis[2]) / length2;
+                tMin = std::min(tMin, t);
+                tMax = std::max(tMax, t);
+            }
+            for (int c = 0; c < 3; c++) {
+                lo[c] = std::min(std::max(mean[c] + tMin * axis[c], 0.0f), 255.0f);
+                hi[c] = std::min(std::max(mean[c] + tMax * axis[c], 0.0f), 255.0f);
+            }
+        } else {
+            for (int c = 0; c < 3; c++) lo[c] = hi[c] = mean[c];
+        }
+    }
+
+    ColorEncoding best = encodeEndpoints(block, hi, lo);
+    if (quality == CompressQuality::High) {
+        for (int iteration = 0; iteration < 3 && best.error > 0.0f; iteration++) {
+            if (!refineEndpoints(block, best.indices, hi, lo)) break;
+            ColorEncoding refined = encodeEndpoints(block, hi, lo);
+            if (refined.error >= best.error) break;
+            best = refined;
+        }
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) bits |= uint32_t(best.indices[i]) << (2 * i);
+    out[0] = uint8_t(best.c0);
+    out[1] = uint8_t(best.c0 >> 8);
+    out[2] = uint8_t(best.c1);
+    out[3] = uint8_t(best.c1 >> 8);
+    for (int i = 0; i < 4; i++) out[4 + i] = uint8_t(bits >> (8 * i));
+}
+
+// eight values for a0 > a1, otherwise six plus 0 and 255
+void channelPalette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+    } else {
+        for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+int selectChannelIndices(const uint8_t values[16], int a0, int a1, uint8_t indices[16]) {
+    int palette[8];
+    channelPalette(a0, a1, palette);
+    int total = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = INT32_MAX;
+        for (int k = 0; k < 8; k++) {
+            int d = (values[i] - palette[k]) * (values[i] - palette[k]);
+            if (d < best) {
+                best = d;
+                indices[i] = static_cast<uint8_t>(k);
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+// a BC4 block (also the alpha half of BC3 and each half of BC5)
+void encodeChannelBlock(const uint8_t values[16], CompressQuality quality, uint8_t *out) {
+    int lo = 255, hi = 0;
+    // the six value mode covers what lies strictly between 0 and 255 and gets those two exactly
+    int innerLo = 255, innerHi = 0;
+    for (int i = 0; i < 16; i++) {
+        lo = std::min<int>(lo, values[i]);
+        hi = std::max<int>(hi, values[i]);
+        if (values[i] != 0 && values[i] != 255) {
+            innerLo = std::min<int>(innerLo, values[i]);
+            innerHi = std::max<int>(innerHi, values[i]);
+        }
+    }
+
+    int bestA0 = hi, bestA1 = lo;
+    uint8_t best[16], candidate[16];
+    int bestError = selectChannelIndices(values, hi, lo, best);
+    auto consider = [&](int a0, int a1) {
+        if (a0 < 0 || a0 > 255 || a1 < 0 || a1 > 255) return;
+        int error = selectChannelIndices(values, a0, a1, candidate);
+        if (error < bestError) {
+            bestError = error;
+            bestA0 = a0;
+            bestA1 = a1;
+            std::memcpy(best, candidate, 16);
+        }
+    };
+
+    if (quality != CompressQuality::Fast && bestError > 0) {
+        if (innerLo <= innerHi) consider(innerLo, innerHi);
+        else consider(lo, hi);
+    }
+    if (quality == CompressQuality::High && bestError > 0) {
+        // small steps around both modes' endpoints, keeping each mode's order
+        const int a0 = bestA0, a1 = bestA1;
+        for (int d0 = -1; d0 <= 1; d0++) {
+            for (int d1 = -1; d1 <= 1; d1++) {
+                if ((a0 + d0 > a1 + d1) == (a0 > a1)) consider(a0 + d0, a1 + d1);
+            }
+        }
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++) bits |= uint64_t(best[i]) << (3 * i);
+    out[0] = uint8_t(bestA0);
+    out[1] = uint8_t(bestA1);
+    for (int i = 0; i < 6; i++) out[2 + i] = uint8_t(bits >> (8 * i));
+}
+
+void encodeBlock(const uint8_t pixels[16][4], BlockFormat format, CompressQuality quality, uint8_t *out) {
+    uint8_t channel[16];
+    auto extract = [&](int c) {
+        for (int i = 0; i < 16; i++) channel[i] = pixels[i][c];
+    };
+    switch (format) {
+    case BlockFormat::BC1:
+        encodeColorBlock(pixels, quality, out);
+        break;
+    case BlockFormat::BC3:
+        extract(3);
+        encodeChannelBlock(channel, quality, out);
+        encodeColorBlock(pixels, quality, out + 8);
+        break;
+    case BlockFormat::BC4:
+        extract(0);
+        encodeChannelBlock(channel, quality, out);
+        break;
+    case BlockFormat::BC5:
+        extract(0);
+        encodeChannelBlock(channel, quality, out);
+        extract(1);
+        encodeChannelBlock(channel, quality, out + 8);
+        break;
+    }
+}
+
+// fourColor forces the four-colour palette, as BC3 colour blocks always decode with it
+void decodeColorBlock(const uint8_t *in, bool fourColor, uint8_t pixels[16][4]) {
+    uint16_t c0 = uint16_t(in[0] | (in[1] << 8)), c1 = uint16_t(in[2] | (in[3] << 8));
+    int a[3], b[3];
+    unpack565(c0, a);
+    unpack565(c1, b);
+    uint8_t palette[4][4];
+    for (int c = 0; c < 3; c++) {
+        palette[0][c] = uint8_t(a[c]);
+        palette[1][c] = uint8_t(b[c]);
+        if (fourColor || c0 > c1) {
+            palette[2][c] = uint8_t((2 * a[c] + b[c]) / 3);
+            palette[3][c] = uint8_t((a[c] + 2 * b[c]) / 3);
+        } else {
+            palette[2][c] = uint8_t((a[c] + b[c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = fourColor || c0 > c1 ? 255 : 0;
+
+    uint32_t bits = uint32_t(in[4]) | (uint32_t(in[5]) << 8) | (uint32_t(in[6]) << 16) | (uint32_t(in[7]) << 24);
+    for (int i = 0; i < 16; i++) std::memcpy(pixels[i], palette[(bits >> (2 * i)) & 3], 4);
+}
+
+void decodeChannelBlock(const uint8_t *in, uint8_t pixels[16][4], int channel) {
+    int palette[8];
+    channelPalette(in[0], in[1], palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++) bits |= uint64_t(in[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; i++) pixels[i][channel] = uint8_t(palette[(bits >> (3 * i)) & 7]);
+}
+
+float psnr(double squaredError, size_t samples) {
+    if (squaredError == 0.0 || samples == 0) return std::numeric_limits<float>::infinity();
+    double mse = squaredError / double(samples);
+    return float(10.0 * std::log10(255.0 * 255.0 / mse));
+}
+
+} // namespace
+
+void Ygg::compressBlocks(const uint8_t *rgba, unsigned int width, unsigned int height, BlockFormat format,
+                         CompressQuality quality, uint8_t *destination, JobSystem *jobs) {
+    if (width == 0 || height == 0) return;
+    const unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t size = blockBytes(format);
+    auto encodeRows = [&](size_t begin, size_t end) {
+        uint8_t pixels[16][4];
+        for (size_t by = begin; by < end; by++) {
+            uint8_t *out = destination + by * blocksX * size;
+            for (unsigned int bx = 0; bx < blocksX; bx++, out += size) {
+                loadBlock(rgba, width, height, bx, static_cast<unsigned int>(by), pixels);
+                encodeBlock(pixels, format, quality, out);
+            }
+        }
+    };
+    if (jobs) {
+        // around a thousand blocks per job
+        jobs->parallelFor(blocksY, std::max<size_t>(1, 1024 / blocksX), encodeRows);
+    } else {
+        encodeRows(0, blocksY);
+    }
+}
+
+void Ygg::decompressBlocks(const uint8_t *blocks, unsigned int width, unsigned int height, BlockFormat format,
+                           uint8_t *rgba) {
+    const unsigned int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    const size_t size = blockBytes(format);
+    uint8_t pixels[16][4];
+    for (unsigned int by = 0; by < blocksY; by++) {
+        for (unsigned int bx = 0; bx < blocksX; bx++) {
+            const uint8_t *in = blocks + (size_t(by) * blocksX + bx) * size;
+            std::memset(pixels, 0, sizeof(pixels));
+            for (int i = 0; i < 16; i++) pixels[i][3] = 255;
+            switch (format) {
+            case BlockFormat::BC1:
+                decodeColorBlock(in, false, pixels);
+                break;
+            case BlockFormat::BC3:
+                decodeColorBlock(in + 8, true, pixels);
+                decodeChannelBlock(in, pixels, 3);
+                break;
+            case BlockFormat::BC4:
+                decodeChannelBlock(in, pixels, 0);
+                break;
+            case BlockFormat::BC5:
+                decodeChannelBlock(in, pixels, 0);
+                decodeChannelBlock(in + 8, pixels, 1);
+                break;
+            }
+            for (unsigned int y = 0; y < 4 && by * 4 + y < height; y++) {
+                for (unsigned int x = 0; x < 4 && bx * 4 + x < width; x++) {
+                    std::memcpy(rgba + ((size_t(by) * 4 + y) * width + bx * 4 + x) * 4, pixels[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+}
+
+Ygg::CompressionReport Ygg::measureCompression(const uint8_t *rgba, const uint8_t *blocks, unsigned int width,
+                                               unsigned int height, BlockFormat format) {
+    const size_t pixelCount = size_t(width) * height;
+    std::vector<uint8_t> decoded(pixelCount * 4);
+    decompressBlocks(blocks, width, height, format, decoded.data());
+
+    const unsigned int channels = format == BlockFormat::BC4 ? 1 : (format == BlockFormat::BC5 ? 2 : 3);
+    double colorError = 0.0, alphaError = 0.0;
+    for (size_t i = 0; i < pixelCount; i++) {
+        for (unsigned int c = 0; c < channels; c++) {
+            double d = double(rgba[i * 4 + c]) - double(decoded[i * 4 + c]);
+            colorError += d * d;
+        }
+        double d = double(rgba[i * 4 + 3]) - double(decoded[i * 4 + 3]);
+        alphaError += d * d;
+    }
+
+    CompressionReport report;
+    report.psnr = psnr(colorError, pixelCount * channels);
+    if (format == BlockFormat::BC3) report.alphaPsnr = psnr(alphaError, pixelCount);
+    return report;
+}
@@ -0,0 +1,340 @@
+#include "ygg/bvh.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+Ygg::Aabb merge(const Ygg::Aabb &a, const Ygg::Aabb &b) {
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+enum class Containment { Outside, Intersects, Inside };
+
+// p/n-vertex test: the corner furthest along each plane normal decides outside, the nearest
+// corner decides fully inside
+Containment classify(const Ygg::Frustum &frustum, const Ygg::Aabb &box) {
+    Containment result = Containment::Inside;
+    for (const glm::vec4 &plane : frustum.planes) {
+        glm::vec3 n(plane);
+        glm::vec3 positive(n.x >= 0.0f ? box.max.x : box.min.x,
+                           n.y >= 0.0f ? box.max.y : box.min.y,
+                           n.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(n, positive) + plane.w < 0.0f) return Containment::Outside;
+
+        glm::vec3 negative(n.x >= 0.0f ? box.min.x : box.max.x,
+                           n.y >= 0.0f ? box.min.y : box.max.y,
+                           n.z >= 0.0f ? box.min.z : box.max.z);
+        if (glm::dot(n, negative) + plane.w < 0.0f) result = Containment::Intersects;
+    }
+    return result;
+}
+
+// zero components get a huge finite reciprocal instead of infinity: an origin lying on a slab plane
+// would otherwise give 0 * inf = NaN and fail the slab test
+glm::vec3 inverseDirection(const glm::vec3 &direction) {
+    auto reciprocal = [](float d) { return d != 0.0f ? 1.0f / d : std::copysign(1e30f, d); };
+    return glm::vec3(reciprocal(direction.x), reciprocal(direction.y), reciprocal(direction.z));
+}
+
+// slab test; returns the entry distance or a negative value on a miss
+float slabTest(const Ygg::Aabb &box, const glm::vec3 &origin, const glm::vec3 &invDirection, float maxDistance) {
+    glm::vec3 t0 = (box.min - origin) * invDirection;
+    glm::vec3 t1 = (box.max - origin) * invDirection;
+    glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    return enter <= exit ? enter : -1.0f;
+}
+
+} // namespace
+
+float Ygg::intersectRay(const Aabb &box, const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance) {
+    return slabTest(box, origin, inverseDirection(direction), maxDistance);
+}
+
+int32_t Ygg::DynamicBvh::allocateNode() {
+    if (freeList == NullNode) {
+        nodes.emplace_back();
+        return static_cast<int32_t>(nodes.size() - 1);
+    }
+    int32_t node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node] = Node();
+    return node;
+}
+
+void Ygg::DynamicBvh::freeNode(int32_t node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+int32_t Ygg::DynamicBvh::insert(const Aabb &box, uint32_t userData) {
+    int32_t proxy = allocateNode();
+    nodes[proxy].box = {box.min - glm::vec3(margin), box.max + glm::vec3(margin)};
+    nodes[proxy].userData = userData;
+    nodes[proxy].height = 0;
+    insertLeaf(proxy);
+    leafCount++;
+    return proxy;
+}
+
+void Ygg::DynamicBvh::remove(int32_t proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    leafCount--;
+}
+
+bool Ygg::DynamicBvh::move(int32_t proxy, const Aabb &box, const glm::vec3 &displacement) {
+    if (nodes[proxy].box.contains(box)) return false;
+
+    removeLeaf(proxy);
+
+    // predict ahead along the motion so the next few frames still fit
+    Aabb fat = {box.min - glm::vec3(margin), box.max + glm::vec3(margin)};
+    glm::vec3 ahead = displacement * 2.0f;
+    fat.min += glm::min(ahead, glm::vec3(0.0f));
+    fat.max += glm::max(ahead, glm::vec3(0.0f));
+    nodes[proxy].box = fat;
+
+    insertLeaf(proxy);
+    return true;
+}
+
+void Ygg::DynamicBvh::clear() {
+    nodes.clear();
+    root = NullNode;
+    freeList = NullNode;
+    leafCount = 0;
+}
+
+void Ygg::DynamicBvh::insertLeaf(int32_t leaf) {
+    if (root == NullNode) {
+        root = leaf;
+        nodes[root].parent = NullNode;
+        return;
+    }
+
+    // descend towards the sibling with the lowest surface area cost
+    const Aabb leafBox = nodes[leaf].box;
+    int32_t index = root;
+    while (!nodes[index].isLeaf()) {
+        int32_t child1 = nodes[index].child1;
+        int32_t child2 = nodes[index].child2;
+
+        float area = nodes[index].box.surfaceArea();
+        float combinedArea = merge(nodes[index].box, leafBox).surfaceArea();
+        // cost of pairing the leaf with this node, and the inherited cost pushed down to either child
+        float cost = 2.0f * combinedArea;
+        float inheritance = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int32_t child) {
+            float merged = merge(leafBox, nodes[child].box).surfaceArea();
+            if (nodes[child].isLeaf()) return merged + inheritance;
+            return merged - nodes[child].box.surfaceArea() + inheritance;
+        };
+        float cost1 = descendCost(child1);
+        float cost2 = descendCost(child2);
+
+        if (cost < cost1 && cost < cost2) break;
+        index = cost1 < cost2 ? child1 : child2;
+    }
+    int32_t sibling = index;
+
+    // new parent takes the sibling's place
+    int32_t oldParent = nodes[sibling].parent;
+    int32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = merge(leafBox, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == NullNode) {
+        root = newParent;
+    } else if (nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+    } else {
+        nodes[oldParent].child2 = newParent;
+    }
+
+    refit(nodes[leaf].parent);
+}
+
+void Ygg::DynamicBvh::removeLeaf(int32_t leaf) {
+    if (leaf == root) {
+        root = NullNode;
+        return;
+    }
+
+    // the sibling replaces the leaf's parent
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandParent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent == NullNode) {
+        root = sibling;
+        nodes[sibling].parent = NullNode;
+        freeNode(parent);
+        return;
+    }
+
+    if (nodes[grandParent].child1 == parent) {
+        nodes[grandParent].child1 = sibling;
+    } else {
+        nodes[grandParent].child2 = sibling;
+    }
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    refit(grandParent);
+}
+
+// walks to the root rebalancing and refitting every ancestor
+void Ygg::DynamicBvh::refit(int32_t index) {
+    while (index != NullNode) {
+        index = balance(index);
+
+        int32_t child1 = nodes[index].child1;
+        int32_t child2 = nodes[index].child2;
+        nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+        nodes[index].box = merge(nodes[child1].box, nodes[child2].box);
+
+        index = nodes[index].parent;
+    }
+}
+
+// If one child of a is two levels taller than the other, rotates the taller child up into a's
+// place. Returns the node now at a's position.
+int32_t Ygg::DynamicBvh::balance(int32_t a) {
+    Node &A = nodes[a];
+    if (A.isLeaf() || A.height < 2) return a;
+
+    int32_t b = A.child1, c = A.child2;
+    int32_t heightDiff = nodes[c].height - nodes[b].height;
+
+    // rotate the taller child (up) into a's place; its shorter grandchild moves under a
+    auto rotate = [&](int32_t up, int32_t other) {
+        Node &U = nodes[up];
+        int32_t f = U.child1, g = U.child2;
+
+        U.child1 = a;
+        U.parent = nodes[a].parent;
+        nodes[a].parent = up;
+
+        if (U.parent == NullNode) {
+            root = up;
+        } else if (nodes[U.parent].child1 == a) {
+            nodes[U.parent].child1 = up;
+        } else {
+            nodes[U.parent].child2 = up;
+        }
+
+        // the taller grandchild stays with up, the other replaces up under a
+        int32_t keep = nodes[f].height > nodes[g].height ? f : g;
+        int32_t give = keep == f ? g : f;
+        U.child2 = keep;
+        if (nodes[a].child1 == up) {
+            nodes[a].child1 = give;
+        } else {
+            nodes[a].child2 = give;
+        }
+        nodes[give].parent = a;
+
+        nodes[a].box = merge(nodes[other].box, nodes[give].box);
+        nodes[a].height = 1 + std::max(nodes[other].height, nodes[give].height);
+        U.box = merge(nodes[a].box, nodes[keep].box);
+        U.height = 1 + std::max(nodes[a].height, nodes[keep].height);
+        return up;
+    };
+
+    if (heightDiff > 1) return rotate(c, b);
+    if (heightDiff < -1) return rotate(b, c);
+    return a;
+}
+
+void Ygg::DynamicBvh::collectLeaves(int32_t node, std::vector<uint32_t> &out) const {
+    std::vector<int32_t> stack;
+    stack.push_back(node);
+    while (!stack.empty()) {
+        const Node &n = nodes[stack.back()];
+        stack.pop_back();
+        if (n.isLeaf()) {
+            out.push_back(n.userData);
+        } else {
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+        }
+    }
+}
+
+void Ygg::DynamicBvh::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &out) const {
+    if (root == NullNode) return;
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty()) {
+        int32_t index = stack.back();
+        stack.pop_back();
+        const Node &node = nodes[index];
+
+        Containment c = classify(frustum, node.box);
+        if (c == Containment::Outside) continue;
+        if (c == Containment::Inside || node.isLeaf()) {
+            collectLeaves(index, out);
+            continue;
+        }
+        stack.push_back(node.child1);
+        stack.push_back(node.child2);
+    }
+}
+
+void Ygg::DynamicBvh::queryAabb(const Aabb &region, std::vector<uint32_t> &out) const {
+    if (root == NullNode) return;
+
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (!node.box.overlaps(region)) continue;
+
+        if (node.isLeaf()) {
+            out.push_back(node.userData);
+        } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+void Ygg::DynamicBvh::queryRay(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                               std::vector<RayHit> &out) const {
+    if (root == NullNode) return;
+
+    const glm::vec3 invDirection = inverseDirection(direction);
+
+    size_t first = out.size();
+    std::vector<int32_t> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        float distance = slabTest(node.box, origin, invDirection, maxDistance);
+        if (distance < 0.0f) continue;
+
+        if (node.isLeaf()) {
+            out.push_back({node.userData, distance});
+        } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+
+    std::sort(out.begin() + first, out.end(),
+              [](const RayHit &a, const RayHit &b) { return a.distance < b.distance; });
+}
@@ -0,0 +1,145 @@
+#include "ygg/culling.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define YGG_CULLING_AVX 1
+#endif
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define YGG_CULLING_SSE 1
+#endif
+
+Ygg::Bounds Ygg::computeBounds(const Vertex *vertices, size_t count) {
+    Bounds bounds;
+    if (count == 0) return bounds;
+
+    bounds.min = bounds.max = vertices[0].pos;
+    for (size_t i = 1; i < count; i++) {
+        bounds.min = glm::min(bounds.min, vertices[i].pos);
+        bounds.max = glm::max(bounds.max, vertices[i].pos);
+    }
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+    float radius2 = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 d = vertices[i].pos - bounds.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    bounds.radius = std::sqrt(radius2);
+    return bounds;
+}
+
+glm::vec4 Ygg::transformSphere(const Bounds &bounds, const glm::mat4 &model) {
+    glm::vec3 center = glm::vec3(model * glm::vec4(bounds.center, 1.0f));
+    float scale2 = std::max(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                   std::max(glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                            glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))));
+    return glm::vec4(center, bounds.radius * std::sqrt(scale2));
+}
+
+void Ygg::transformAabb(const Bounds &bounds, const glm::mat4 &model, glm::vec3 &outMin, glm::vec3 &outMax) {
+    glm::vec3 center = glm::vec3(model * glm::vec4(bounds.center, 1.0f));
+    glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+    glm::vec3 world = glm::abs(glm::vec3(model[0])) * extent.x
+                    + glm::abs(glm::vec3(model[1])) * extent.y
+                    + glm::abs(glm::vec3(model[2])) * extent.z;
+    outMin = center - world;
+    outMax = center + world;
+}
+
+Ygg::Frustum Ygg::Frustum::fromMatrix(const glm::mat4 &m) {
+    // rows of the matrix; glm is column-major
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+    for (glm::vec4 &plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) plane /= length;
+    }
+    return frustum;
+}
+
+bool Ygg::Frustum::containsSphere(const glm::vec4 &sphere) const {
+    for (const glm::vec4 &plane : planes) {
+        if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) return false;
+    }
+    return true;
+}
+
+size_t Ygg::cullSpheres(const Frustum &frustum, const float *x, const float *y, const float *z, const float *radius,
+                        size_t count, uint8_t *visible) {
+    size_t i = 0;
+    size_t visibleCount = 0;
+
+    // each lane holds one sphere; it survives while dot(n, c) + d + r >= 0 for every plane
+#ifdef YGG_CULLING_AVX
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+    for (int p = 0; p < 6; p++) {
+        planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+        planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+        planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+        planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+    }
+    const __m256 zero8 = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        __m256 cx = _mm256_loadu_ps(x + i), cy = _mm256_loadu_ps(y + i), cz = _mm256_loadu_ps(z + i);
+        __m256 r = _mm256_loadu_ps(radius + i);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m256 d = _mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy));
+            d = _mm256_add_ps(d, _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), _mm256_add_ps(planeW[p], r)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, zero8, _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; lane++) {
+            uint8_t v = uint8_t((mask >> lane) & 1);
+            visible[i + lane] = v;
+            visibleCount += v;
+        }
+    }
+#endif
+
+#ifdef YGG_CULLING_SSE
+    __m128 planeX4[6], planeY4[6], planeZ4[6], planeW4[6];
+    for (int p = 0; p < 6; p++) {
+        planeX4[p] = _mm_set1_ps(frustum.planes[p].x);
+        planeY4[p] = _mm_set1_ps(frustum.planes[p].y);
+        planeZ4[p] = _mm_set1_ps(frustum.planes[p].z);
+        planeW4[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+    const __m128 zero4 = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 cx = _mm_loadu_ps(x + i), cy = _mm_loadu_ps(y + i), cz = _mm_loadu_ps(z + i);
+        __m128 r = _mm_loadu_ps(radius + i);
+        __m128 inside = _mm_cmpeq_ps(zero4, zero4);
+        for (int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(_mm_mul_ps(planeX4[p], cx), _mm_mul_ps(planeY4[p], cy));
+            d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(planeZ4[p], cz), _mm_add_ps(planeW4[p], r)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero4));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++) {
+            uint8_t v = uint8_t((mask >> lane) & 1);
+            visible[i + lane] = v;
+            visibleCount += v;
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        visible[i] = frustum.containsSphere(glm::vec4(x[i], y[i], z[i], radius[i])) ? 1 : 0;
+        visibleCount += visible[i];
+    }
+    return visibleCount;
+}
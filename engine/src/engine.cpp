@@ -1,13 +1,14 @@
 #include "ygg/engine.hpp"
 #include "glm/glm.hpp"
 #include "glm/ext.hpp"
+#include <cstring>
 // #include ""
 
 // using namespace 
 // define static member
 GLFWwindow* Ygg::RenderEngine::window = nullptr;
 
-int Ygg::RenderEngine::initGL(const char *vShader, const char *fShader) {
+int Ygg::RenderEngine::initGL(const char *vShader, const char *fShader, const char *vShaderInstanced) {
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
         return -1;
@@ -37,6 +38,23 @@ int Ygg::RenderEngine::initGL(const char *vShader, const char *fShader) {
 
     // compile shader program (assumes Shader has a ctor taking paths)
     program = Program(vShader, fShader);
+    instancedProgram = Program(vShaderInstanced, fShader);
+    programUniforms.resolve(program);
+    for (Program *p : {&program, &instancedProgram}) {
+        p->bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+        p->bindUniformBlock("LightData", LIGHT_DATA_BINDING);
+    }
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    uniformStream.init(GL_UNIFORM_BUFFER, 16 * 1024);
+    uploadFrameBlocks();
+    frameDataValid = false;
+
+    instanceStream.init(GL_ARRAY_BUFFER, 1024 * sizeof(InstanceData));
+
+    jobs.init();
+    queue.setJobSystem(&jobs);
+    textures.init(&jobs);
 
     glEnable(GL_DEPTH_TEST);
     return 0;
@@ -48,6 +66,13 @@ Ygg::Camera Ygg::RenderEngine::createCamera(glm::vec3 pos) {
     return Camera(pos);
 }
 
+int Ygg::RenderEngine::initLineBatch(const char *vShader, const char *fShader) {
+    lineBatch.init(vShader, fShader);
+    return lineBatch.isInitialized() ? 0 : -1;
+}
+
+Ygg::LineBatch& Ygg::RenderEngine::getLineBatch() { return lineBatch; }
+
 Ygg::Line Ygg::RenderEngine::createLine()
 {
     Line line;
@@ -97,26 +122,137 @@ void Ygg::RenderEngine::updateLine(const Line& line,
         color.x, color.y, color.z
     };
 
+    // a Line must keep its contents until the next update, so it can't live in a ring that gets
+    // reused; orphaning still avoids the implicit sync of writing into storage the GPU is reading
     glBindBuffer(GL_ARRAY_BUFFER, line.VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(data), nullptr, GL_DYNAMIC_DRAW);
     glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(data), data);
 }
 
 
+void Ygg::RenderEngine::enableInstanceAttributes(GLuint vao) {
+    glBindVertexArray(vao);
+
+    // instance attributes 3-10 advance once per instance; draws point them at their records
+    for (unsigned int location = 3; location <= 10; location++) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    bindInstanceAttributes(instanceStream.buffer(), 0);
+
+    glBindVertexArray(0);
+}
+
+Ygg::GeometryPool& Ygg::RenderEngine::getPool(VertexFormat format) {
+    GeometryPool &pool = pools[static_cast<unsigned int>(format)];
+    if (!pool.isInitialized()) {
+        pool.init(format);
+        enableInstanceAttributes(pool.vao());
+    }
+    return pool;
+}
+
+const Ygg::GeometryRange& Ygg::RenderEngine::getRange(const Mesh &mesh) const {
+    return pools[static_cast<unsigned int>(mesh.format)].range(mesh.geometry);
+}
+
+void Ygg::RenderEngine::setVertexFormat(VertexFormat format) { vertexFormat = format; }
+
+Ygg::VertexFormat Ygg::RenderEngine::getVertexFormat() const { return vertexFormat; }
+
+Ygg::Mesh Ygg::RenderEngine::uploadMesh(std::vector<Vertex> vertices, std::vector<unsigned> indices,
+                                        VertexFormat format, MeshOptimizeStats *stats,
+                                        const std::vector<uint32_t> &lodStarts, const std::vector<float> &lodErrors) {
+    EncodedMesh encoded = encodeMesh(std::move(vertices), std::move(indices), format, lodStarts, lodErrors, stats);
+    return createMesh(encoded.view());
+}
+
+Ygg::Mesh Ygg::RenderEngine::createMesh(const MeshData &data) {
+    // the pool copies straight from data, which may be a mapped file
+    GeometryPool &pool = getPool(data.format);
+    Mesh mesh;
+    mesh.format = data.format;
+    mesh.indexType = data.indexType;
+    mesh.dequantize = data.dequantize;
+    mesh.geometry = pool.allocate(data.vertices, data.vertexCount, data.indices, data.indexBytes);
+    mesh.VAO = pool.vao();
+    mesh.bounds = data.bounds;
+    mesh.model = glm::mat4(1.0f);
+    mesh.color = data.color;
+
+    mesh.lodCount = data.lodCount;
+    for (unsigned int lod = 0; lod < mesh.lodCount; lod++) mesh.lods[lod] = data.lods[lod];
+    mesh.indexCount = mesh.lods[0].indexCount;
+    return mesh;
+}
+
+Ygg::Mesh Ygg::RenderEngine::createMesh(const std::vector<Vertex> &vertices, const std::vector<unsigned> &indices,
+                                        const glm::vec3 &color, MeshOptimizeStats *stats) {
+    Mesh mesh = uploadMesh(vertices, indices, vertexFormat, stats);
+    mesh.model = glm::mat4(1.0f);
+    mesh.color = color;
+    return mesh;
+}
+
+Ygg::Mesh Ygg::RenderEngine::createMesh(const std::vector<Vertex> &vertices,
+                                        const std::vector<std::vector<unsigned>> &lodIndices,
+                                        const std::vector<float> &lodErrors, const glm::vec3 &color,
+                                        MeshOptimizeStats *stats) {
+    std::vector<unsigned> indices;
+    std::vector<uint32_t> lodStarts;
+    for (size_t lod = 0; lod < lodIndices.size() && lod < MAX_MESH_LODS; lod++) {
+        lodStarts.push_back(static_cast<uint32_t>(indices.size()));
+        indices.insert(indices.end(), lodIndices[lod].begin(), lodIndices[lod].end());
+    }
+
+    Mesh mesh = uploadMesh(vertices, indices, vertexFormat, stats, lodStarts, lodErrors);
+    mesh.model = glm::mat4(1.0f);
+    mesh.color = color;
+    return mesh;
+}
+
+Ygg::Mesh Ygg::RenderEngine::getPrimitive(const PrimitiveKey &key) {
+    auto it = primitiveCache.find(key);
+    if (it == primitiveCache.end()) {
+        // the cache keeps the reference returned by the upload for as long as the engine lives
+        Mesh unit = key.type == PrimitiveType::Box ? buildUnitBox(key.format)
+                                                   : buildUnitSphere(key.stacks, key.slices, key.format);
+        it = primitiveCache.emplace(key, unit).first;
+    }
+
+    Mesh mesh = it->second;
+    getPool(mesh.format).retain(mesh.geometry);
+    return mesh;
+}
+
 Ygg::Mesh Ygg::RenderEngine::createBox(const glm::vec3 &pos, const glm::quat &orientation,
                                        float width, float height, float depth, const glm::vec3 &color) {
+    Mesh mesh = getPrimitive({PrimitiveType::Box, 0, 0, vertexFormat});
+    mesh.model = glm::translate(glm::mat4(1.0f), pos)
+               * glm::mat4_cast(orientation)
+               * glm::scale(glm::mat4(1.0f), {width, height, depth});
+    mesh.color = color;
+    return mesh;
+}
 
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), pos)
-                    * glm::mat4_cast(orientation)
-                    * glm::scale(glm::mat4(1.0f), {width, height, depth});
-
-    // program.setMat4("model", model);
+Ygg::Mesh Ygg::RenderEngine::createSphere(const glm::vec3 &pos, const glm::quat &orientation,
+                                          float radius, const glm::vec3 &color,
+                                          unsigned int stacks, unsigned int slices) {
+    Mesh mesh = getPrimitive({PrimitiveType::Sphere, stacks, slices, vertexFormat});
+    mesh.model = glm::translate(glm::mat4(1.0f), pos)
+               * glm::mat4_cast(orientation)
+               * glm::scale(glm::mat4(1.0f), glm::vec3(radius));
+    mesh.color = color;
+    return mesh;
+}
 
+Ygg::Mesh Ygg::RenderEngine::buildUnitBox(VertexFormat format) {
+    // unit cube centred on the origin; vertex colour is white so the per-object colour shows through
     std::vector<Vertex> vertices(8);
 
     for (int i = 0; i < 8; i++) {
-        glm::vec4 transformed = model * glm::vec4(unit_box[i], 1.0f);
-        vertices[i].pos = glm::vec3(transformed);
-        vertices[i].color = color;
+        vertices[i].pos = unit_box[i];
+        vertices[i].color = glm::vec3(1.0f);
         vertices[i].normal = glm::vec3(0.0f); // temporarily zero
     }
 
@@ -149,41 +285,7 @@ for (size_t i = 0; i < vertices.size(); i++)
     // ---------------------------------------
     // 4. Upload to OpenGL
     // ---------------------------------------
-    Mesh mesh;
-
-    glGenVertexArrays(1, &mesh.VAO);
-    glGenBuffers(1, &mesh.VBO);
-    glGenBuffers(1, &mesh.EBO);
-
-    glBindVertexArray(mesh.VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-    glBufferData(GL_ARRAY_BUFFER,
-                 vertices.size() * sizeof(Vertex),   // FIXED
-                 vertices.data(),
-                 GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 indices.size() * sizeof(unsigned),
-                 indices.data(),
-                 GL_STATIC_DRAW);
-
-    // layout: pos(3), normal(3), color(3)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex,pos));
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex,normal));
-    glEnableVertexAttribArray(1);
-
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex,color));
-    glEnableVertexAttribArray(2);
-
-    glBindVertexArray(0);
-
-    mesh.indexCount = 36;
-    mesh.model = model;
-    return mesh;
+    return uploadMesh(vertices, indices, format);
 }
 
 
@@ -192,16 +294,22 @@ for (size_t i = 0; i < vertices.size(); i++)
 
 
 
-Ygg::Mesh Ygg::RenderEngine::createSphere(const glm::vec3 &pos,
-const glm::quat &orientation,
-float radius,
-const glm::vec3 &color,
-unsigned int stacks,
-unsigned int slices)
+Ygg::Mesh Ygg::RenderEngine::buildUnitSphere(unsigned int stacks, unsigned int slices, VertexFormat format)
 {
 std::vector<Vertex> vertices;
 std::vector<unsigned int> indices;
-
+std::vector<uint32_t> lodStarts;
+std::vector<float> lodErrors;
+
+// LOD chain: every level halves the tessellation, down to 4 stacks/slices. Each level gets its own
+// vertices, appended after the previous level's
+for (unsigned int lod = 0; lod < MAX_MESH_LODS && (lod == 0 || (stacks >= 4 && slices >= 4)); ++lod) {
+unsigned int base = static_cast<unsigned int>(vertices.size());
+lodStarts.push_back(static_cast<uint32_t>(indices.size()));
+// largest gap between the unit sphere and the faceted one: the sagitta of the widest chord
+float stackError = 1.0f - cos(glm::pi<float>() / (2.0f * stacks));
+float sliceError = 1.0f - cos(glm::pi<float>() / slices);
+lodErrors.push_back(std::max(stackError, sliceError));
 
 // generate vertices
 for (unsigned int i = 0; i <= stacks; ++i) {
@@ -219,14 +327,14 @@ float y = cos(phi);
 float z = sin(phi) * sin(theta);
 
 
-glm::vec3 position = glm::vec3(x, y, z) * radius;
+glm::vec3 position = glm::vec3(x, y, z);
 glm::vec3 normal = glm::normalize(glm::vec3(x, y, z));
 
 
 Vertex vert;
 vert.pos = position;
 vert.normal = normal;
-vert.color = color;
+vert.color = glm::vec3(1.0f);
 vertices.push_back(vert);
 }
 }
@@ -235,7 +343,7 @@ vertices.push_back(vert);
 // generate indices (triangles)
 for (unsigned int i = 0; i < stacks; ++i) {
 for (unsigned int j = 0; j < slices; ++j) {
-unsigned int first = i * (slices + 1) + j;
+unsigned int first = base + i * (slices + 1) + j;
 unsigned int second = first + slices + 1;
 
 
@@ -251,68 +359,93 @@ indices.push_back(first + 1);
 }
 }
 
-
-// transform positions by model (do NOT transform normals here with non-uniform scale; we will store model)
-glm::mat4 model = glm::translate(glm::mat4(1.0f), pos) * glm::mat4_cast(orientation);
+stacks /= 2;
+slices /= 2;
+}
 
 
 // upload to GPU
-Mesh mesh;
-glGenVertexArrays(1, &mesh.VAO);
-glGenBuffers(1, &mesh.VBO);
-glGenBuffers(1, &mesh.EBO);
-
-
-glBindVertexArray(mesh.VAO);
-
-
-glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-
-glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
-glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-
-
-// vertex layout: pos(0), normal(1), color(2)
-glEnableVertexAttribArray(0);
-glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
-
-
-glEnableVertexAttribArray(1);
-glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+return uploadMesh(vertices, indices, format, nullptr, lodStarts, lodErrors);
+}
 
 
-glEnableVertexAttribArray(2);
-glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
 
 
-glBindVertexArray(0);
 
 
-mesh.indexCount = static_cast<unsigned int>(indices.size());
-mesh.model = model;
-return mesh;
+void Ygg::RenderEngine::drawMesh(const Mesh &mesh, const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos, const glm::mat4 &rotAndPos) {
+    setFrameUniforms(view, projection, cameraPos);
+    drawMesh(mesh, rotAndPos);
 }
 
+const Ygg::MeshLod& Ygg::RenderEngine::chooseLod(const Mesh &mesh, const glm::mat4 &model, uint8_t *lodState) {
+    unsigned int lod = 0;
+    if (mesh.lodCount > 1) {
+        glm::vec4 sphere = transformSphere(mesh.bounds, model);
+        float scale = mesh.bounds.radius > 0.0f ? sphere.w / mesh.bounds.radius : 1.0f;
+        float distance = glm::length(glm::vec3(sphere) - glm::vec3(frameData.cameraPos)) - sphere.w;
+        float ppu = pixelsPerUnit(frameData.projection[1][1], float(SCR_HEIGHT), distance) * scale;
+        lod = selectLod(mesh.lods, mesh.lodCount, ppu, lodState ? *lodState : 0, lodBudget, lodHysteresis);
+        if (lodState) *lodState = static_cast<uint8_t>(lod);
+    }
+    return mesh.lods[lod];
+}
 
+void Ygg::RenderEngine::drawMesh(const Mesh &mesh, const glm::mat4 &model, uint8_t *lodState) {
+    glm::mat4 transform = mesh.format == VertexFormat::CompactQuantized ? applyDequantize(model, mesh.dequantize)
+                                                                        : model;
+    program.use();    
+    program.setMat4(programUniforms.model, transform);
+    program.setMat3(programUniforms.normalMatrix, computeNormalMatrix(model).toMat3());
+    program.setVec3(programUniforms.objectColor, mesh.color);
+    const GeometryRange &range = getRange(mesh);
+    const MeshLod &lod = chooseLod(mesh, model, lodState);
+    glBindVertexArray(mesh.VAO);
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(lod.indexCount), mesh.indexType,
+                             (void*)(uintptr_t)(range.indexOffset + lod.indexOffset),
+                             static_cast<GLint>(range.firstVertex));
+    glBindVertexArray(0);
+}
 
+void Ygg::RenderEngine::drawMeshInstanced(const Mesh &mesh, const glm::mat4 *models, size_t count) {
+    if (count == 0) return;
+
+    GLintptr offset;
+    InstanceData *instances = static_cast<InstanceData*>(
+        instanceStream.map(count * sizeof(InstanceData), 16, offset));
+    if (!instances) return;
+    packInstanceData(models, count, instances);
+    for (size_t i = 0; i < count; i++) instances[i].color = glm::vec4(mesh.color, 1.0f);
+    if (mesh.format == VertexFormat::CompactQuantized) {
+        // normal matrices stay those of the undequantized models
+        for (size_t i = 0; i < count; i++) instances[i].model = applyDequantize(models[i], mesh.dequantize);
+    }
+    instanceStream.unmap();
 
+    instancedProgram.use();
+    const GeometryRange &range = getRange(mesh);
+    glBindVertexArray(mesh.VAO);
+    bindInstanceAttributes(instanceStream.buffer(), offset);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), mesh.indexType,
+                                      (void*)(uintptr_t)range.indexOffset, static_cast<GLsizei>(count),
+                                      static_cast<GLint>(range.firstVertex));
+    glBindVertexArray(0);
+}
 
+void Ygg::RenderEngine::drawMeshInstanced(const Mesh &mesh, const std::vector<glm::mat4> &models) {
+    drawMeshInstanced(mesh, models.data(), models.size());
+}
 
-void Ygg::RenderEngine::drawMesh(const Mesh &mesh, const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos, const glm::mat4 &rotAndPos) {
+void Ygg::RenderEngine::drawMeshInstanced(const Mesh &mesh, const glm::mat4 *models, size_t count,
+                                          const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos) {
+    setFrameUniforms(view, projection, cameraPos);
+    drawMeshInstanced(mesh, models, count);
+}
 
-    glm::mat4 updated = rotAndPos;
-    program.use();    
-    program.setMat4("projection", projection);
-    program.setMat4("view", view);
-    program.setMat4("model", updated);
-    program.setVec3("lightPos", glm::vec3(0.0f, 10.0f, 3.0f));   
-    program.setVec3("lightColor", glm::vec3(1.0f));             
-    program.setVec3("cameraPos", cameraPos);           
-    glBindVertexArray(mesh.VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+void Ygg::RenderEngine::drawMeshInstanced(const Mesh &mesh, const std::vector<glm::mat4> &models,
+                                          const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos) {
+    setFrameUniforms(view, projection, cameraPos);
+    drawMeshInstanced(mesh, models.data(), models.size());
 }
 
 void Ygg::RenderEngine::drawLine(const Line& line,
@@ -320,16 +453,18 @@ void Ygg::RenderEngine::drawLine(const Line& line,
                             const glm::mat4& proj, 
                             const glm::vec3 &cameraPos,
                             glm::vec3 color)
+{
+    setFrameUniforms(view, proj, cameraPos);
+    drawLine(line);
+}
+
+void Ygg::RenderEngine::drawLine(const Line& line)
 {
     program.use();
     glm::mat4 model = glm::mat4(1.0f);
-    program.setMat4("model", model);
-    program.setMat4("view", view);
-    program.setMat4("projection", proj);
-    program.setVec3("lightPos", glm::vec3(0.0f, 10.0f, 3.0f));   
-    program.setVec3("lightColor", glm::vec3(1.0f));   
-    // program.setVec3("color", color);
-    program.setVec3("cameraPos", cameraPos);            // ADD
+    program.setMat4(programUniforms.model, model);
+    program.setMat3(programUniforms.normalMatrix, glm::mat3(1.0f));
+    program.setVec3(programUniforms.objectColor, glm::vec3(1.0f));
 
 
     glBindVertexArray(line.VAO);
@@ -338,25 +473,199 @@ void Ygg::RenderEngine::drawLine(const Line& line,
 
 
 
+void Ygg::RenderEngine::beginFrame(const Camera &cam) {
+    setCameraUniforms(cam);
+    beginFrame(frameData.view, frameData.projection, glm::vec3(frameData.cameraPos));
+}
+
+void Ygg::RenderEngine::beginFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos) {
+    setFrameUniforms(view, projection, cameraPos);
+    queue.begin(view, projection);
+    queue.setLodBudget(lodBudget, lodHysteresis, float(SCR_HEIGHT));
+    jobs.pumpMain();
+    textures.update();
+    if (occlusion.getLevelCount() == 0) occlusion.init(256, 128, &jobs);
+    occlusion.beginFrame(projection * view);
+}
+
+void Ygg::RenderEngine::submitMesh(const Mesh &mesh, const glm::mat4 &model, uint16_t material, uint8_t *lodState) {
+    submitMesh(mesh, model, mesh.color, material, lodState);
+}
+
+void Ygg::RenderEngine::submitMesh(const Mesh &mesh, const glm::mat4 &model, const glm::vec3 &color,
+                                   uint16_t material, uint8_t *lodState) {
+    // the dequantize scale is uniform, so the normal matrix the queue derives from this model is only
+    // off by a constant factor
+    const glm::mat4 &transform = mesh.format == VertexFormat::CompactQuantized
+                               ? applyDequantize(model, mesh.dequantize) : model;
+    queue.push(program, &instancedProgram, mesh, getRange(mesh), transform, color,
+               transformSphere(mesh.bounds, model), material, lodState);
+}
+
+void Ygg::RenderEngine::recordMeshes(size_t count, size_t grain,
+                                     const std::function<void(MeshRecorder&, size_t, size_t)> &body) {
+    queue.record(count, grain, [&](DrawRecorder &recorder, size_t begin, size_t end) {
+        MeshRecorder meshes(*this, recorder);
+        body(meshes, begin, end);
+    });
+}
+
+void Ygg::MeshRecorder::submit(const Mesh &mesh, const glm::mat4 &model, uint16_t material, uint8_t *lodState) {
+    submit(mesh, model, mesh.color, material, lodState);
+}
+
+void Ygg::MeshRecorder::submit(const Mesh &mesh, const glm::mat4 &model, const glm::vec3 &color, uint16_t material,
+                               uint8_t *lodState) {
+    // as RenderEngine::submitMesh; the engine's programs and pools are only read
+    const glm::mat4 &transform = mesh.format == VertexFormat::CompactQuantized
+                               ? applyDequantize(model, mesh.dequantize) : model;
+    recorder.push(engine.program, &engine.instancedProgram, mesh, engine.getRange(mesh), transform, color,
+                  transformSphere(mesh.bounds, model), material, lodState);
+}
+
+Ygg::Entity Ygg::RenderEngine::createRenderable(const Mesh &mesh, const glm::mat4 &model, NodeHandle node,
+                                                const glm::mat4 &offset) {
+    Entity entity = registry.create();
+    registry.add<Transform>(entity, {model});
+    registry.add<MeshRef>(entity, {&mesh});
+    registry.add<Material>(entity, {mesh.color, 0});
+    registry.add<WorldBounds>(entity);
+    registry.add<Visibility>(entity);
+    if (node) registry.add<SceneNode>(entity, {node, offset});
+    return entity;
+}
+
+void Ygg::RenderEngine::destroyRenderable(Entity entity) {
+    Ygg::destroyRenderable(registry, entityBvh, entity);
+}
+
+Ygg::RenderRegistry& Ygg::RenderEngine::getRegistry() { return registry; }
+
+Ygg::Entity Ygg::RenderEngine::pickRenderable(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                                              float *distance) {
+    return Ygg::pickRenderable(registry, entityBvh, origin, direction, maxDistance, distance);
+}
+
+void Ygg::RenderEngine::queryRenderables(const Aabb &region, std::vector<Entity> &out) {
+    Ygg::queryRenderables(registry, entityBvh, region, out);
+}
+
+Ygg::JobSystem& Ygg::RenderEngine::getJobSystem() { return jobs; }
+
+Ygg::TextureManager& Ygg::RenderEngine::getTextureManager() { return textures; }
+
+void Ygg::RenderEngine::submitRenderables(const SceneGraph *scene) {
+    // pools only need re-sorting after entities or components came or went
+    if (packedVersion != registry.structureVersion()) {
+        packRenderables(registry);
+        packedVersion = registry.structureVersion();
+    }
+    if (scene) updateTransforms(registry, *scene, &jobs);
+    updateBounds(registry, entityBvh, &jobs);
+    cullRenderables(registry, entityBvh, Frustum::fromMatrix(frameData.projection * frameData.view), visibleEntities);
+    buildDrawList(registry, *this);
+}
+
+void Ygg::RenderEngine::addOccluder(const Mesh &mesh, const glm::mat4 &model) {
+    occlusion.addOccluderBox(mesh.bounds.min, mesh.bounds.max, model);
+}
+
+Ygg::OcclusionCuller& Ygg::RenderEngine::getOcclusionCuller() { return occlusion; }
+
+void Ygg::RenderEngine::endFrame() {
+    // occlusion only costs anything in frames that have occluders
+    bool occluders = occlusion.getOccluderTriangles() > 0;
+    if (occluders) occlusion.rasterize();
+    queue.setOcclusion(occluders ? &occlusion : nullptr);
+    queue.flush();
+    lineBatch.flush();
+    uniformStream.endFrame();
+    instanceStream.endFrame();
+    jobs.pumpMain();
+}
+
+void Ygg::RenderEngine::setSubmitMode(SubmitMode mode) {
+    queue.setSubmitMode(mode);
+}
+
+void Ygg::RenderEngine::setLodBudget(float budgetPixels, float hysteresis) {
+    lodBudget = budgetPixels;
+    lodHysteresis = hysteresis;
+}
+
+void Ygg::RenderEngine::setCulling(bool enabled) {
+    queue.setCulling(enabled);
+}
+
+const Ygg::RenderQueueStats& Ygg::RenderEngine::getRenderStats() const {
+    return queue.getStats();
+}
+
 void Ygg::RenderEngine::cleanupMesh(Mesh &mesh) {
-    if (mesh.VAO) glDeleteVertexArrays(1, &mesh.VAO);
-    if (mesh.VBO) glDeleteBuffers(1, &mesh.VBO);
-    if (mesh.EBO) glDeleteBuffers(1, &mesh.EBO);
+    if (mesh.geometry) {
+        GeometryPool &pool = getPool(mesh.format);
+        pool.free(mesh.geometry);
+        // close the holes once a quarter of the pool is lost to them
+        if (pool.fragmentation() > 0.25f) pool.compact();
+    }
     mesh = {};
 }
 
 void Ygg::RenderEngine::terminate() {
+    // decodes still running need the workers
+    textures.destroy();
+    jobs.shutdown();
+    queue.destroy();
+    lineBatch.destroy();
+    primitiveCache.clear();
+    registry = RenderRegistry();
+    entityBvh.clear();
+    for (GeometryPool &pool : pools) pool.destroy();
+    instanceStream.destroy();
+    uniformStream.destroy();
     if (window) glfwDestroyWindow(window);
     glfwTerminate();
 }
 
 void Ygg::RenderEngine::setCameraUniforms(const Camera &cam) {
-    program.use();
     glm::mat4 view = cam.getViewMatrix();
     glm::mat4 proj = glm::perspective(glm::radians(cam.getFov()), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+    setFrameUniforms(view, proj, cam.getCameraPos());
+}
+
+void Ygg::RenderEngine::setFrameUniforms(const glm::mat4& view, const glm::mat4& projection, const glm::vec3 &cameraPos) {
+    FrameData data;
+    data.projection = projection;
+    data.view = view;
+    data.cameraPos = glm::vec4(cameraPos, 1.0f);
+
+    // the legacy draw calls pass the same matrices for every object, so most calls end here
+    if (frameDataValid && std::memcmp(&data, &frameData, sizeof(FrameData)) == 0) return;
+
+    frameData = data;
+    frameDataValid = true;
+    uploadFrameBlocks();
+}
+
+void Ygg::RenderEngine::setLight(const glm::vec3 &pos, const glm::vec3 &color) {
+    lightData.lightPos = glm::vec4(pos, 1.0f);
+    lightData.lightColor = glm::vec4(color, 1.0f);
+    uploadFrameBlocks();
+}
 
-    // Assumes Shader has setMat4 API
-    program.setMat4("view", view);
-    program.setMat4("projection", proj);
+void Ygg::RenderEngine::uploadFrameBlocks() {
+    // both blocks go in together so the most recent write always holds both; the ring may reuse
+    // whatever was bound before
+    size_t lightOffset = (sizeof(FrameData) + uniformAlignment - 1) / uniformAlignment * uniformAlignment;
+    GLintptr offset;
+    char *dst = static_cast<char*>(uniformStream.map(lightOffset + sizeof(LightData), uniformAlignment, offset));
+    if (!dst) return;
+    std::memcpy(dst, &frameData, sizeof(FrameData));
+    std::memcpy(dst + lightOffset, &lightData, sizeof(LightData));
+    uniformStream.unmap();
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, uniformStream.buffer(), offset, sizeof(FrameData));
+    glBindBufferRange(GL_UNIFORM_BUFFER, LIGHT_DATA_BINDING, uniformStream.buffer(), offset + lightOffset,
+                      sizeof(LightData));
 }
 
@@ -0,0 +1,267 @@
+#include "ygg/geometry_pool.hpp"
+#include <algorithm>
+#include <cstring>
+
+void Ygg::RangeAllocator::reset(uint32_t capacity, uint32_t used) {
+    freeRanges.clear();
+    total = capacity;
+    available = capacity - used;
+    if (available > 0) freeRanges[used] = available;
+}
+
+bool Ygg::RangeAllocator::allocate(uint32_t size, uint32_t alignment, uint32_t &offset) {
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        uint32_t start = it->first, end = it->first + it->second;
+        uint32_t aligned = (start + alignment - 1) / alignment * alignment;
+        if (aligned > end || end - aligned < size) continue;
+
+        freeRanges.erase(it);
+        // alignment padding and the remainder go back on the free list
+        if (aligned > start) freeRanges[start] = aligned - start;
+        if (aligned + size < end) freeRanges[aligned + size] = end - (aligned + size);
+
+        available -= size;
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+void Ygg::RangeAllocator::free(uint32_t offset, uint32_t size) {
+    if (size == 0) return;
+    available += size;
+
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+    if (next != freeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+        }
+    }
+    freeRanges[offset] = size;
+}
+
+void Ygg::RangeAllocator::grow(uint32_t newCapacity) {
+    if (newCapacity <= total) return;
+    uint32_t oldCapacity = total;
+    total = newCapacity;
+    free(oldCapacity, newCapacity - oldCapacity);
+}
+
+uint32_t Ygg::RangeAllocator::holeSpace() const {
+    if (freeRanges.empty()) return 0;
+    auto last = std::prev(freeRanges.end());
+    bool trailing = last->first + last->second == total;
+    return trailing ? available - last->second : available;
+}
+
+GLenum Ygg::chooseIndexType(uint32_t vertexCount, bool allowByte) {
+    if (allowByte && vertexCount <= 0x100) return GL_UNSIGNED_BYTE;
+    if (vertexCount <= 0x10000) return GL_UNSIGNED_SHORT;
+    return GL_UNSIGNED_INT;
+}
+
+uint32_t Ygg::indexTypeSize(GLenum indexType) {
+    switch (indexType) {
+    case GL_UNSIGNED_BYTE: return 1;
+    case GL_UNSIGNED_SHORT: return 2;
+    default: return 4;
+    }
+}
+
+void Ygg::packIndices(const uint32_t *indices, size_t count, GLenum indexType, std::vector<unsigned char> &out) {
+    out.resize(count * indexTypeSize(indexType));
+    switch (indexType) {
+    case GL_UNSIGNED_BYTE:
+        for (size_t i = 0; i < count; i++) out[i] = static_cast<uint8_t>(indices[i]);
+        break;
+    case GL_UNSIGNED_SHORT: {
+        uint16_t *dst = reinterpret_cast<uint16_t*>(out.data());
+        for (size_t i = 0; i < count; i++) dst[i] = static_cast<uint16_t>(indices[i]);
+        break;
+    }
+    default:
+        if (count) std::memcpy(out.data(), indices, count * sizeof(uint32_t));
+        break;
+    }
+}
+
+// index allocations are padded to 4 bytes so every index type stays aligned
+static uint32_t indexSpan(uint32_t indexBytes) {
+    return (indexBytes + 3) & ~3u;
+}
+
+void Ygg::GeometryPool::init(VertexFormat format, uint32_t vertexCapacity, uint32_t indexCapacity) {
+    vertexFormat = format;
+    stride = getVertexLayout(format).stride;
+    glGenVertexArrays(1, &VAO);
+    vertexSpace.reset(0);
+    indexSpace.reset(0);
+    resizeVertexBuffer(vertexCapacity);
+    resizeIndexBuffer(indexCapacity);
+
+    ranges.assign(1, GeometryRange());
+    refs.assign(1, 0);
+    freeHandles.clear();
+}
+
+void Ygg::GeometryPool::destroy() {
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    if (VBO) glDeleteBuffers(1, &VBO);
+    if (EBO) glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
+    ranges.clear();
+    refs.clear();
+    freeHandles.clear();
+}
+
+void Ygg::GeometryPool::bindVertexLayout() {
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    // vertex layout: pos(0), normal(1), color(2)
+    getVertexLayout(vertexFormat).apply();
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBindVertexArray(0);
+}
+
+// Buffers are replaced rather than re-specified so the old contents can be copied across with
+// glCopyBufferSubData; offsets of live allocations are unchanged.
+void Ygg::GeometryPool::resizeVertexBuffer(uint32_t capacity) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(capacity) * stride, nullptr, GL_STATIC_DRAW);
+
+    if (VBO) {
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            GLsizeiptr(vertexSpace.capacity()) * stride);
+        glDeleteBuffers(1, &VBO);
+    }
+    VBO = buffer;
+    vertexSpace.grow(capacity);
+    bindVertexLayout();
+}
+
+void Ygg::GeometryPool::resizeIndexBuffer(uint32_t capacity) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+
+    if (EBO) {
+        glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, indexSpace.capacity());
+        glDeleteBuffers(1, &EBO);
+    }
+    EBO = buffer;
+    indexSpace.grow(capacity);
+    bindVertexLayout();
+}
+
+Ygg::GeometryHandle Ygg::GeometryPool::allocate(const void *vertices, uint32_t vertexCount,
+                                                const void *indices, uint32_t indexBytes) {
+    GeometryRange r;
+    r.vertexCount = vertexCount;
+    r.indexBytes = indexBytes;
+
+    // grow geometrically until the request fits
+    while (!vertexSpace.allocate(vertexCount, 1, r.firstVertex)) {
+        resizeVertexBuffer(std::max(vertexSpace.capacity() * 2, vertexSpace.capacity() + vertexCount));
+    }
+    while (!indexSpace.allocate(indexSpan(indexBytes), 4, r.indexOffset)) {
+        resizeIndexBuffer(std::max(indexSpace.capacity() * 2, indexSpace.capacity() + indexSpan(indexBytes) + 4));
+    }
+
+    // upload through the copy target so no VAO's element binding is disturbed
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(r.firstVertex) * stride,
+                    GLsizeiptr(vertexCount) * stride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, r.indexOffset, indexBytes, indices);
+
+    GeometryHandle handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = static_cast<GeometryHandle>(ranges.size());
+        ranges.emplace_back();
+        refs.push_back(0);
+    }
+    ranges[handle] = r;
+    refs[handle] = 1;
+    return handle;
+}
+
+void Ygg::GeometryPool::retain(GeometryHandle handle) {
+    if (handle == 0 || handle >= ranges.size() || refs[handle] == 0) return;
+    refs[handle]++;
+}
+
+void Ygg::GeometryPool::free(GeometryHandle handle) {
+    if (handle == 0 || handle >= ranges.size() || refs[handle] == 0) return;
+    if (--refs[handle] > 0) return;
+
+    const GeometryRange &r = ranges[handle];
+    vertexSpace.free(r.firstVertex, r.vertexCount);
+    indexSpace.free(r.indexOffset, indexSpan(r.indexBytes));
+    ranges[handle] = GeometryRange();
+    freeHandles.push_back(handle);
+}
+
+float Ygg::GeometryPool::fragmentation() const {
+    float vertexHoles = vertexSpace.capacity() ? float(vertexSpace.holeSpace()) / vertexSpace.capacity() : 0.0f;
+    float indexHoles = indexSpace.capacity() ? float(indexSpace.holeSpace()) / indexSpace.capacity() : 0.0f;
+    return std::max(vertexHoles, indexHoles);
+}
+
+void Ygg::GeometryPool::compact() {
+    // live allocations are copied into fresh buffers back to back; vertex and index ranges are packed independently
+    std::vector<GeometryHandle> handles;
+    for (GeometryHandle h = 1; h < ranges.size(); h++) {
+        if (refs[h] > 0) handles.push_back(h);
+    }
+
+    GLuint newVBO, newEBO;
+    glGenBuffers(1, &newVBO);
+    glGenBuffers(1, &newEBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(vertexSpace.capacity()) * stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newEBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexSpace.capacity(), nullptr, GL_STATIC_DRAW);
+
+    uint32_t vertexCursor = 0, indexCursor = 0;
+    for (GeometryHandle h : handles) {
+        GeometryRange &r = ranges[h];
+
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            GLintptr(r.firstVertex) * stride, GLintptr(vertexCursor) * stride,
+                            GLsizeiptr(r.vertexCount) * stride);
+        r.firstVertex = vertexCursor;
+        vertexCursor += r.vertexCount;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newEBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, r.indexOffset, indexCursor, r.indexBytes);
+        r.indexOffset = indexCursor;
+        indexCursor += indexSpan(r.indexBytes);
+    }
+
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    VBO = newVBO;
+    EBO = newEBO;
+    vertexSpace.reset(vertexSpace.capacity(), vertexCursor);
+    indexSpace.reset(indexSpace.capacity(), indexCursor);
+    bindVertexLayout();
+}
@@ -0,0 +1,212 @@
+#include "ygg/job_system.hpp"
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+namespace {
+
+// the worker running on this thread; the main thread (and any other) has none
+constexpr unsigned int NotAWorker = ~0u;
+thread_local const Ygg::JobSystem *currentSystem = nullptr;
+thread_local unsigned int currentWorker = NotAWorker;
+
+unsigned int workerIndex(const Ygg::JobSystem *system) {
+    return currentSystem == system ? currentWorker : NotAWorker;
+}
+
+void pinThread(std::thread &thread, unsigned int core) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % CPU_SETSIZE, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#elif defined(_WIN32)
+    SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+} // namespace
+
+void Ygg::JobSystem::init(unsigned int workerCount, ThreadAffinity affinity) {
+    shutdown();
+    if (workerCount == 0) workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+    running = true;
+    for (unsigned int i = 0; i < workerCount; i++) workers.push_back(std::make_unique<Worker>());
+    // deques exist before any thread starts stealing from them
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+        if (affinity == ThreadAffinity::PinCores) pinThread(workers[i]->thread, i + 1);
+    }
+}
+
+void Ygg::JobSystem::shutdown() {
+    if (!running) return;
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        running = false;
+    }
+    wake.notify_all();
+    for (std::unique_ptr<Worker> &worker : workers) worker->thread.join();
+    workers.clear();
+    queued = 0;
+}
+
+void Ygg::JobSystem::run(Job job, JobCounter *counter) {
+    if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+    if (workers.empty()) {
+        execute(job, counter);
+        return;
+    }
+    // workers keep their own jobs; everyone else deals them out
+    unsigned int self = workerIndex(this);
+    unsigned int worker = self != NotAWorker ? self
+                        : nextWorker.fetch_add(1, std::memory_order_relaxed) % getWorkerCount();
+    push(worker, std::move(job), counter);
+}
+
+void Ygg::JobSystem::runAfter(JobCounter &dependency, Job job, JobCounter *counter) {
+    // counted from now, so waiting on counter covers the time spent parked
+    if (counter) counter->pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> guard(dependency.lock);
+        if (!dependency.done()) {
+            dependency.continuations.push_back({std::move(job), counter});
+            return;
+        }
+    }
+    run(std::move(job), counter);
+    if (counter) finish(counter);
+}
+
+void Ygg::JobSystem::push(unsigned int worker, Job job, JobCounter *counter) {
+    {
+        std::lock_guard<std::mutex> guard(workers[worker]->lock);
+        workers[worker]->jobs.emplace_back(std::move(job), counter);
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    // lock so a worker between checking queued and sleeping doesn't miss this
+    { std::lock_guard<std::mutex> guard(sleepLock); }
+    wake.notify_one();
+}
+
+bool Ygg::JobSystem::runOne(unsigned int self) {
+    const unsigned int count = getWorkerCount();
+    if (count == 0 || queued.load(std::memory_order_acquire) == 0) return false;
+
+    std::pair<Job, JobCounter*> job;
+    bool found = false;
+    if (self != NotAWorker) {
+        Worker &own = *workers[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+    // steal, starting after ourselves so thieves spread over the victims
+    unsigned int start = self != NotAWorker ? self + 1 : nextWorker.load(std::memory_order_relaxed);
+    for (unsigned int i = 0; i < count && !found; i++) {
+        Worker &victim = *workers[(start + i) % count];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            found = true;
+        }
+    }
+    if (!found) return false;
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    execute(job.first, job.second);
+    return true;
+}
+
+void Ygg::JobSystem::execute(Job &job, JobCounter *counter) {
+    job();
+    if (counter) finish(counter);
+}
+
+void Ygg::JobSystem::finish(JobCounter *counter) {
+    uint32_t value = counter->pending.load(std::memory_order_relaxed);
+    while (value > 1) {
+        if (counter->pending.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel)) return;
+    }
+
+    // Probably the last job. The final decrement happens under the lock, and waiters take the lock
+    // after seeing zero, so the counter can't be destroyed while this still touches it
+    std::vector<JobCounter::Continuation> ready;
+    {
+        std::lock_guard<std::mutex> guard(counter->lock);
+        if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        ready.swap(counter->continuations);
+    }
+    // each was counted on its own counter by runAfter already
+    for (JobCounter::Continuation &c : ready) {
+        run(std::move(c.job), c.counter);
+        if (c.counter) finish(c.counter);
+    }
+}
+
+void Ygg::JobSystem::wait(JobCounter &counter) {
+    while (!counter.done()) {
+        if (!runOne(workerIndex(this))) std::this_thread::yield();
+    }
+    // the last finish() may still hold the lock
+    std::lock_guard<std::mutex> guard(counter.lock);
+}
+
+void Ygg::JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    if (workers.empty() || count <= grain) {
+        body(0, count);
+        return;
+    }
+
+    // the calling thread takes the first chunk instead of idling
+    JobCounter counter;
+    for (size_t begin = grain; begin < count; begin += grain) {
+        size_t end = std::min(count, begin + grain);
+        run([&body, begin, end]() { body(begin, end); }, &counter);
+    }
+    body(0, grain);
+    wait(counter);
+}
+
+void Ygg::JobSystem::runOnMain(Job job) {
+    std::lock_guard<std::mutex> guard(mainLock);
+    mainJobs.push_back(std::move(job));
+}
+
+void Ygg::JobSystem::pumpMain() {
+    std::vector<Job> jobs;
+    {
+        std::lock_guard<std::mutex> guard(mainLock);
+        jobs.swap(mainJobs);
+    }
+    // jobs queued while these run wait for the next pump
+    for (Job &job : jobs) job();
+}
+
+void Ygg::JobSystem::workerLoop(unsigned int index) {
+    currentSystem = this;
+    currentWorker = index;
+    while (true) {
+        if (runOne(index)) continue;
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [&]() { return !running || queued.load(std::memory_order_acquire) > 0; });
+        if (!running) break;
+    }
+}
@@ -0,0 +1,87 @@
+#include "ygg/line_batch.hpp"
+#include "ygg/frame_data.hpp"
+#include "glm/gtc/packing.hpp"
+#include <cstring>
+
+void Ygg::LineBatch::init(const char *vShader, const char *fShader, size_t capacity) {
+    program = Shader(vShader, fShader);
+    program.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+
+    stream.init(GL_ARRAY_BUFFER, capacity * sizeof(LineVertex));
+
+    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer());
+
+    // Position (location = 0)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(LineVertex), (void*)offsetof(LineVertex, pos));
+    glEnableVertexAttribArray(0);
+
+    // Color (location = 2), normalised RGBA8
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LineVertex), (void*)offsetof(LineVertex, color));
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+}
+
+void Ygg::LineBatch::destroy() {
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    stream.destroy();
+    if (program.ID) glDeleteProgram(program.ID);
+    VAO = 0;
+    vertices.clear();
+}
+
+uint32_t Ygg::LineBatch::packColor(const glm::vec3 &color) {
+    return glm::packUnorm4x8(glm::vec4(glm::clamp(color, 0.0f, 1.0f), 1.0f));
+}
+
+void Ygg::LineBatch::addLine(const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &color) {
+    uint32_t packed = packColor(color);
+    vertices.push_back({p1, packed});
+    vertices.push_back({p2, packed});
+}
+
+void Ygg::LineBatch::addPolyline(const glm::vec3 *points, size_t count, const glm::vec3 &color, bool closed) {
+    if (count < 2) return;
+    uint32_t packed = packColor(color);
+
+    vertices.reserve(vertices.size() + 2 * count);
+    for (size_t i = 0; i + 1 < count; i++) {
+        vertices.push_back({points[i], packed});
+        vertices.push_back({points[i + 1], packed});
+    }
+    if (closed) {
+        vertices.push_back({points[count - 1], packed});
+        vertices.push_back({points[0], packed});
+    }
+}
+
+void Ygg::LineBatch::addPolyline(const std::vector<glm::vec3> &points, const glm::vec3 &color, bool closed) {
+    addPolyline(points.data(), points.size(), color, closed);
+}
+
+void Ygg::LineBatch::flush() {
+    if (vertices.empty() || !VAO) {
+        vertices.clear();
+        return;
+    }
+
+    size_t count = vertices.size() - vertices.size() % 2;
+
+    // offsets are multiples of the vertex size, so the draw can start at offset / sizeof(LineVertex)
+    GLintptr offset;
+    void *dst = stream.map(count * sizeof(LineVertex), sizeof(LineVertex), offset);
+    if (dst) {
+        std::memcpy(dst, vertices.data(), count * sizeof(LineVertex));
+        stream.unmap();
+
+        program.use();
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_LINES, GLint(offset / GLintptr(sizeof(LineVertex))), GLsizei(count));
+        glBindVertexArray(0);
+    }
+    stream.endFrame();
+
+    vertices.clear();
+}
@@ -0,0 +1,15 @@
+#include "ygg/lod.hpp"
+
+unsigned int Ygg::selectLod(const MeshLod *lods, unsigned int lodCount, float pixelsPerUnit, unsigned int current,
+                            float budget, float hysteresis) {
+    // levels are ordered finest first, so errors only grow along the chain
+    unsigned int target = 0;
+    for (unsigned int i = 1; i < lodCount; i++) {
+        if (lods[i].error * pixelsPerUnit > budget) break;
+        target = i;
+    }
+
+    float coarsenBudget = budget * (1.0f - hysteresis);
+    while (target > current && lods[target].error * pixelsPerUnit > coarsenBudget) target--;
+    return target;
+}
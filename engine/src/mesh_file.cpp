@@ -0,0 +1,368 @@
+#include "ygg/mesh_file.hpp"
+#include "ygg/geometry_pool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// values are written and mapped in host order, so the writer and the reader must be little-endian
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error ".yggmesh files are little-endian; big-endian hosts would need to byte swap them"
+#endif
+
+namespace {
+
+// reads back as BYTE_ORDER_MARK only in the byte order it was written in
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+const char MAGIC[8] = {'Y', 'G', 'G', 'M', 'E', 'S', 'H', '\0'};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;        // sizes let a reader catch a file written with other structs
+    uint32_t recordSize;
+    uint32_t meshCount;
+    uint64_t recordOffset;
+    uint64_t fileSize;
+    uint32_t byteOrder;         // BYTE_ORDER_MARK
+    uint32_t reserved;
+};
+
+struct FileAttribute {
+    uint32_t location;
+    int32_t size;
+    uint32_t type;
+    uint32_t normalized;
+    uint32_t offset;
+};
+
+struct FileLod {
+    uint32_t indexOffset;       // bytes into the mesh's indices
+    uint32_t indexCount;
+    float error;
+};
+
+struct FileRecord {
+    char name[64];              // NUL terminated
+    uint32_t format;
+    uint32_t indexType;
+    uint32_t vertexCount;
+    uint32_t indexBytes;
+    uint64_t vertexOffset;      // from the start of the file
+    uint64_t indexOffset;
+    uint32_t stride;
+    uint32_t attributeCount;
+    FileAttribute attributes[3];
+    float dequantize[4];
+    float boundsMin[3], boundsMax[3], center[3], radius;
+    float color[3];
+    uint32_t lodCount;
+    FileLod lods[Ygg::MAX_MESH_LODS];
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 48, "FileHeader layout");
+static_assert(sizeof(FileRecord) == 312, "FileRecord layout");
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + Ygg::MESH_FILE_ALIGNMENT - 1) / Ygg::MESH_FILE_ALIGNMENT * Ygg::MESH_FILE_ALIGNMENT;
+}
+
+// whether [offset, offset + size) lies within length bytes, without the sum wrapping around
+bool inRange(uint64_t offset, uint64_t size, uint64_t length) {
+    return offset <= length && size <= length - offset;
+}
+
+// the largest index in count indices of type, at most limit (the scan stops at the first one past it)
+template <typename T>
+uint32_t maxIndex(const void *indices, size_t count, uint32_t limit) {
+    const T *values = static_cast<const T*>(indices);
+    uint32_t largest = 0;
+    for (size_t i = 0; i < count && largest < limit; i++) largest = std::max<uint32_t>(largest, values[i]);
+    return largest;
+}
+
+size_t vertexBytes(const Ygg::MeshData &mesh) {
+    return size_t(mesh.vertexCount) * Ygg::getVertexLayout(mesh.format).stride;
+}
+
+} // namespace
+
+Ygg::MeshData Ygg::EncodedMesh::view() const {
+    MeshData view = data;
+    view.name = name.c_str();
+    view.vertices = vertices.data();
+    view.indices = indices.data();
+    return view;
+}
+
+Ygg::EncodedMesh Ygg::encodeMesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, VertexFormat format,
+                                 const std::vector<uint32_t> &lodStarts, const std::vector<float> &lodErrors,
+                                 MeshOptimizeStats *stats) {
+    optimizeMeshLods(vertices, indices, lodStarts, stats);
+
+    EncodedMesh mesh;
+    MeshData &data = mesh.data;
+    data.format = format;
+    data.bounds = computeBounds(vertices.data(), vertices.size());
+    data.vertexCount = static_cast<uint32_t>(vertices.size());
+    mesh.vertices.resize(vertices.size() * getVertexLayout(format).stride);
+    data.dequantize = encodeVertices(format, vertices.data(), vertices.size(), mesh.vertices.data());
+
+    // indices are relative to the mesh (the draw adds the base vertex), so the mesh's own vertex
+    // count decides the type
+    data.indexType = chooseIndexType(data.vertexCount);
+    packIndices(indices.data(), indices.size(), data.indexType, mesh.indices);
+    data.indexBytes = static_cast<uint32_t>(mesh.indices.size());
+
+    data.lodCount = static_cast<uint8_t>(std::min<size_t>(lodStarts.size(), MAX_MESH_LODS));
+    for (unsigned int lod = 0; lod < data.lodCount; lod++) {
+        uint32_t end = lod + 1 < lodStarts.size() ? lodStarts[lod + 1] : static_cast<uint32_t>(indices.size());
+        data.lods[lod].indexOffset = lodStarts[lod] * indexTypeSize(data.indexType);
+        data.lods[lod].indexCount = end - lodStarts[lod];
+        data.lods[lod].error = lod < lodErrors.size() ? lodErrors[lod] : 0.0f;
+    }
+    return mesh;
+}
+
+bool Ygg::writeMeshFile(const std::string &path, const MeshData *meshes, size_t count) {
+    std::vector<FileRecord> records(count);
+    std::memset(records.data(), 0, records.size() * sizeof(FileRecord));
+
+    uint64_t offset = alignUp(alignUp(sizeof(FileHeader)) + count * sizeof(FileRecord));
+    for (size_t i = 0; i < count; i++) {
+        const MeshData &mesh = meshes[i];
+        const VertexLayout &layout = getVertexLayout(mesh.format);
+        FileRecord &record = records[i];
+
+        std::strncpy(record.name, mesh.name ? mesh.name : "", sizeof(record.name) - 1);
+        record.format = static_cast<uint32_t>(mesh.format);
+        record.indexType = mesh.indexType;
+        record.vertexCount = mesh.vertexCount;
+        record.indexBytes = mesh.indexBytes;
+        record.vertexOffset = offset;
+        offset = alignUp(offset + vertexBytes(mesh));
+        record.indexOffset = offset;
+        offset = alignUp(offset + mesh.indexBytes);
+
+        record.stride = layout.stride;
+        record.attributeCount = 3;
+        for (unsigned int a = 0; a < 3; a++) {
+            const VertexAttribute &attribute = layout.attributes[a];
+            record.attributes[a] = {attribute.location, attribute.size, attribute.type,
+                                    attribute.normalized, attribute.offset};
+        }
+        for (int c = 0; c < 4; c++) record.dequantize[c] = mesh.dequantize[c];
+        for (int c = 0; c < 3; c++) {
+            record.boundsMin[c] = mesh.bounds.min[c];
+            record.boundsMax[c] = mesh.bounds.max[c];
+            record.center[c] = mesh.bounds.center[c];
+            record.color[c] = mesh.color[c];
+        }
+        record.radius = mesh.bounds.radius;
+        record.lodCount = mesh.lodCount;
+        for (unsigned int lod = 0; lod < mesh.lodCount && lod < MAX_MESH_LODS; lod++) {
+            record.lods[lod] = {mesh.lods[lod].indexOffset, mesh.lods[lod].indexCount, mesh.lods[lod].error};
+        }
+    }
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = MESH_FILE_VERSION;
+    header.headerSize = sizeof(FileHeader);
+    header.recordSize = sizeof(FileRecord);
+    header.meshCount = static_cast<uint32_t>(count);
+    header.recordOffset = alignUp(sizeof(FileHeader));
+    header.fileSize = offset;
+    header.byteOrder = BYTE_ORDER_MARK;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    const char zeros[MESH_FILE_ALIGNMENT] = {};
+    auto padTo = [&](uint64_t position) {
+        uint64_t at = static_cast<uint64_t>(out.tellp());
+        if (position > at) out.write(zeros, std::streamsize(position - at));
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padTo(header.recordOffset);
+    out.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size() * sizeof(FileRecord)));
+    for (size_t i = 0; i < count; i++) {
+        padTo(records[i].vertexOffset);
+        out.write(static_cast<const char*>(meshes[i].vertices), std::streamsize(vertexBytes(meshes[i])));
+        padTo(records[i].indexOffset);
+        out.write(static_cast<const char*>(meshes[i].indices), std::streamsize(meshes[i].indexBytes));
+    }
+    padTo(header.fileSize);
+    return static_cast<bool>(out);
+}
+
+bool Ygg::writeMeshFile(const std::string &path, const std::vector<EncodedMesh> &meshes) {
+    std::vector<MeshData> views;
+    views.reserve(meshes.size());
+    for (const EncodedMesh &mesh : meshes) views.push_back(mesh.view());
+    return writeMeshFile(path, views.data(), views.size());
+}
+
+bool Ygg::MeshFile::open(const std::string &path) {
+    close();
+    error.clear();
+
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return fail("can't open " + path);
+    file = handle;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize)) return fail("can't read the size of " + path);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length < sizeof(FileHeader)) return fail(path + " is too small");
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) return fail("can't map " + path);
+    base = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!base) return fail("can't map " + path);
+#else
+    file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) return fail("can't open " + path);
+    struct stat info;
+    if (fstat(file, &info) != 0) return fail("can't read the size of " + path);
+    length = static_cast<size_t>(info.st_size);
+    if (length < sizeof(FileHeader)) return fail(path + " is too small");
+    void *view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+    if (view == MAP_FAILED) return fail("can't map " + path);
+    base = static_cast<const unsigned char*>(view);
+    // the blobs are read front to back as the meshes are uploaded
+    posix_madvise(view, length, POSIX_MADV_SEQUENTIAL);
+#endif
+
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) return fail(path + " is not a .yggmesh file");
+    // before the version, which would read as garbage in the other byte order
+    if (header.byteOrder != BYTE_ORDER_MARK) return fail(path + " was written in another byte order");
+    if (header.version != MESH_FILE_VERSION) {
+        return fail(path + " has version " + std::to_string(header.version) + ", expected " +
+                    std::to_string(MESH_FILE_VERSION));
+    }
+    if (header.headerSize != sizeof(FileHeader) || header.recordSize != sizeof(FileRecord)) {
+        return fail(path + " has unexpected header or record sizes");
+    }
+    if (header.fileSize != length) return fail(path + " is truncated");
+    if (header.recordOffset % alignof(FileRecord) != 0 ||
+        !inRange(header.recordOffset, uint64_t(header.meshCount) * sizeof(FileRecord), length)) {
+        return fail(path + " has a bad mesh table");
+    }
+
+    const FileRecord *records = reinterpret_cast<const FileRecord*>(base + header.recordOffset);
+    meshes.resize(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        const FileRecord &record = records[i];
+        const std::string where = path + " mesh " + std::to_string(i);
+        if (record.name[sizeof(record.name) - 1] != '\0') return fail(where + ": name is not terminated");
+        if (record.format >= VERTEX_FORMAT_COUNT) return fail(where + ": unknown vertex format");
+
+        // the file's layout must be the one the engine will bind
+        const VertexLayout &layout = getVertexLayout(static_cast<VertexFormat>(record.format));
+        bool layoutMatches = record.stride == layout.stride && record.attributeCount == 3;
+        for (unsigned int a = 0; a < 3 && layoutMatches; a++) {
+            const FileAttribute &attribute = record.attributes[a];
+            const VertexAttribute &expected = layout.attributes[a];
+            layoutMatches = attribute.location == expected.location && attribute.size == expected.size &&
+                            attribute.type == expected.type && attribute.normalized == expected.normalized &&
+                            attribute.offset == expected.offset;
+        }
+        if (!layoutMatches) return fail(where + ": vertex layout differs from the engine's");
+
+        if (record.indexType != GL_UNSIGNED_BYTE && record.indexType != GL_UNSIGNED_SHORT &&
+            record.indexType != GL_UNSIGNED_INT) {
+            return fail(where + ": bad index type");
+        }
+        if (record.vertexOffset % MESH_FILE_ALIGNMENT != 0 || record.indexOffset % MESH_FILE_ALIGNMENT != 0 ||
+            !inRange(record.vertexOffset, uint64_t(record.vertexCount) * record.stride, length) ||
+            !inRange(record.indexOffset, record.indexBytes, length)) {
+            return fail(where + ": data lies outside the file");
+        }
+        const uint32_t indexSize = indexTypeSize(record.indexType);
+        if (record.indexBytes % indexSize != 0) return fail(where + ": partial index");
+        // an index past the vertices would have the GPU read outside the mesh's range in the pool
+        const void *indices = base + record.indexOffset;
+        const size_t indexCount = record.indexBytes / indexSize;
+        const uint32_t limit = record.vertexCount;
+        uint32_t largest = record.indexType == GL_UNSIGNED_BYTE  ? maxIndex<uint8_t>(indices, indexCount, limit)
+                         : record.indexType == GL_UNSIGNED_SHORT ? maxIndex<uint16_t>(indices, indexCount, limit)
+                         : maxIndex<uint32_t>(indices, indexCount, limit);
+        if (indexCount > 0 && largest >= record.vertexCount) return fail(where + ": index past the vertices");
+        if (record.lodCount < 1 || record.lodCount > MAX_MESH_LODS) return fail(where + ": bad LOD count");
+        for (uint32_t lod = 0; lod < record.lodCount; lod++) {
+            const FileLod &level = record.lods[lod];
+            if (level.indexOffset % indexSize != 0 ||
+                uint64_t(level.indexOffset) + uint64_t(level.indexCount) * indexSize > record.indexBytes) {
+                return fail(where + ": LOD " + std::to_string(lod) + " lies outside the indices");
+            }
+        }
+
+        MeshData &mesh = meshes[i];
+        mesh.name = record.name;
+        mesh.format = static_cast<VertexFormat>(record.format);
+        mesh.indexType = record.indexType;
+        mesh.vertexCount = record.vertexCount;
+        mesh.indexBytes = record.indexBytes;
+        mesh.vertices = base + record.vertexOffset;
+        mesh.indices = base + record.indexOffset;
+        mesh.dequantize = Dequantize(record.dequantize[0], record.dequantize[1], record.dequantize[2],
+                                     record.dequantize[3]);
+        mesh.bounds.min = glm::vec3(record.boundsMin[0], record.boundsMin[1], record.boundsMin[2]);
+        mesh.bounds.max = glm::vec3(record.boundsMax[0], record.boundsMax[1], record.boundsMax[2]);
+        mesh.bounds.center = glm::vec3(record.center[0], record.center[1], record.center[2]);
+        mesh.bounds.radius = record.radius;
+        mesh.color = glm::vec3(record.color[0], record.color[1], record.color[2]);
+        mesh.lodCount = static_cast<uint8_t>(record.lodCount);
+        for (uint32_t lod = 0; lod < record.lodCount; lod++) {
+            mesh.lods[lod].indexOffset = record.lods[lod].indexOffset;
+            mesh.lods[lod].indexCount = record.lods[lod].indexCount;
+            mesh.lods[lod].error = record.lods[lod].error;
+        }
+    }
+    return true;
+}
+
+void Ygg::MeshFile::close() {
+#if defined(_WIN32)
+    if (base) UnmapViewOfFile(base);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (base) munmap(const_cast<unsigned char*>(base), length);
+    if (file >= 0) ::close(file);
+    file = -1;
+#endif
+    base = nullptr;
+    length = 0;
+    meshes.clear();
+}
+
+int Ygg::MeshFile::find(const std::string &name) const {
+    for (size_t i = 0; i < meshes.size(); i++) {
+        if (name == meshes[i].name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool Ygg::MeshFile::fail(const std::string &reason) {
+    close();
+    error = reason;
+    return false;
+}
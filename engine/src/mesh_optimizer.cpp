@@ -0,0 +1,267 @@
+#include "ygg/mesh_optimizer.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// FIFO post-transform cache: a vertex is cached while fewer than cacheSize others were
+// transformed after it. Time starts past cacheSize so every zeroed stamp reads as a miss.
+struct FifoCache {
+    std::vector<uint32_t> stamps;
+    uint32_t time;
+    unsigned int size;
+
+    FifoCache(size_t vertexCount, unsigned int cacheSize)
+        : stamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+    bool contains(uint32_t v) const { return time - stamps[v] <= size; }
+
+    // returns true on a miss
+    bool access(uint32_t v) {
+        if (contains(v)) return false;
+        stamps[v] = time++;
+        return true;
+    }
+
+    void reset() {
+        // pushing every entry out is cheaper than clearing the stamps
+        time += size + 1;
+    }
+};
+
+} // namespace
+
+Ygg::VertexCacheStats Ygg::analyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount,
+                                              unsigned int cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3) return stats;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t unique = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t v = indices[i];
+        if (cache.access(v)) stats.transformed++;
+        if (!referenced[v]) {
+            referenced[v] = true;
+            unique++;
+        }
+    }
+
+    stats.acmr = float(stats.transformed) / float(indexCount / 3);
+    stats.atvr = float(stats.transformed) / float(unique);
+    return stats;
+}
+
+void Ygg::optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount,
+                              unsigned int cacheSize, std::vector<uint32_t> *clusters) {
+    const size_t triangleCount = indexCount / 3;
+    if (clusters) clusters->clear();
+    if (triangleCount == 0) return;
+
+    // vertex -> triangles adjacency, and how many unemitted triangles still use each vertex
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) live[indices[i]]++;
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + live[v];
+    std::vector<uint32_t> adjacency(offsets[vertexCount]);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    size_t cursor = 0;
+
+    // next vertex that still has triangles left: recent dead ends first, then a linear scan
+    auto skipDeadEnd = [&]() -> int64_t {
+        while (!deadEnds.empty()) {
+            uint32_t d = deadEnds.back();
+            deadEnds.pop_back();
+            if (live[d] > 0) return d;
+        }
+        for (; cursor < vertexCount; cursor++) {
+            if (live[cursor] > 0) return int64_t(cursor);
+        }
+        return -1;
+    };
+
+    int64_t fan = live[0] > 0 ? 0 : skipDeadEnd();
+    if (clusters) clusters->push_back(0);
+
+    while (fan >= 0) {
+        // emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = true;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                cache.access(v);
+            }
+        }
+
+        // prefer the oldest candidate that will still be cached once its own fan is emitted
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            int64_t age = int64_t(cache.time) - int64_t(cache.stamps[v]);
+            if (age + 2 * int64_t(live[v]) <= int64_t(cacheSize)) priority = age;
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0) {
+            next = skipDeadEnd();
+            // continuing from an uncached vertex starts a new run: a hard cluster boundary
+            uint32_t emittedCount = static_cast<uint32_t>(result.size() / 3);
+            if (clusters && next >= 0 && !cache.contains(uint32_t(next)) &&
+                emittedCount < triangleCount && clusters->back() != emittedCount) {
+                clusters->push_back(emittedCount);
+            }
+        }
+        fan = next;
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+void Ygg::optimizeOverdraw(uint32_t *indices, size_t indexCount, const Vertex *vertices, size_t vertexCount,
+                           const std::vector<uint32_t> &clusters, unsigned int cacheSize, float threshold) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0 || clusters.empty()) return;
+
+    // soft boundaries: inside each hard cluster, split wherever a cold cache costs little
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<uint32_t> starts;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        cache.reset();
+        unsigned int clusterMisses = 0;
+        for (size_t t = begin; t < end; t++) {
+            for (int k = 0; k < 3; k++) clusterMisses += cache.access(indices[t * 3 + k]);
+        }
+        float limit = threshold * float(clusterMisses) / float(end - begin);
+
+        cache.reset();
+        starts.push_back(static_cast<uint32_t>(begin));
+        unsigned int misses = 0;
+        size_t splitStart = begin;
+        for (size_t t = begin; t < end; t++) {
+            for (int k = 0; k < 3; k++) misses += cache.access(indices[t * 3 + k]);
+            if (t + 1 < end && float(misses) <= limit * float(t + 1 - splitStart)) {
+                starts.push_back(static_cast<uint32_t>(t + 1));
+                splitStart = t + 1;
+                misses = 0;
+                cache.reset();
+            }
+        }
+    }
+
+    // area weighted centroid and normal of every cluster, and the mesh centroid
+    const size_t clusterCount = starts.size();
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++) {
+        size_t end = c + 1 < clusterCount ? starts[c + 1] : triangleCount;
+        float area = 0.0f;
+        for (size_t t = starts[c]; t < end; t++) {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].pos;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].pos;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float a = glm::length(n);
+            centroids[c] += (p0 + p1 + p2) * (a / 3.0f);
+            normals[c] += n;
+            area += a;
+        }
+        meshCentroid += centroids[c];
+        meshArea += area;
+        if (area > 0.0f) centroids[c] /= area;
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // clusters facing away from the centre are drawn first since they occlude the inner ones
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        float len = glm::length(normals[c]);
+        sortKey[c] = len > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / len) : 0.0f;
+    }
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(triangleCount * 3);
+    for (uint32_t c : order) {
+        size_t end = c + 1 < clusterCount ? starts[c + 1] : triangleCount;
+        result.insert(result.end(), indices + starts[c] * 3, indices + end * 3);
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+size_t Ygg::optimizeVertexFetch(Vertex *vertices, size_t vertexCount, uint32_t *indices, size_t indexCount) {
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertexCount);
+
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t &slot = remap[indices[i]];
+        if (slot == unused) {
+            slot = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[indices[i]]);
+        }
+        indices[i] = slot;
+    }
+
+    std::copy(reordered.begin(), reordered.end(), vertices);
+    return reordered.size();
+}
+
+void Ygg::optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices,
+                       MeshOptimizeStats *stats, unsigned int cacheSize) {
+    optimizeMeshLods(vertices, indices, {0}, stats, cacheSize);
+}
+
+void Ygg::optimizeMeshLods(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices,
+                           const std::vector<uint32_t> &lodStarts, MeshOptimizeStats *stats,
+                           unsigned int cacheSize) {
+    auto lodEnd = [&](size_t lod) { return lod + 1 < lodStarts.size() ? lodStarts[lod + 1] : indices.size(); };
+    if (stats) *stats = {};
+
+    for (size_t lod = 0; lod < lodStarts.size(); lod++) {
+        uint32_t *lodIndices = indices.data() + lodStarts[lod];
+        size_t lodCount = lodEnd(lod) - lodStarts[lod];
+        if (lod == 0 && stats) stats->before = analyzeVertexCache(lodIndices, lodCount, vertices.size(), cacheSize);
+
+        std::vector<uint32_t> clusters;
+        optimizeVertexCache(lodIndices, lodCount, vertices.size(), cacheSize, &clusters);
+        optimizeOverdraw(lodIndices, lodCount, vertices.data(), vertices.size(), clusters, cacheSize);
+        if (lod == 0 && stats) stats->clusters = static_cast<unsigned int>(clusters.size());
+    }
+    vertices.resize(optimizeVertexFetch(vertices.data(), vertices.size(), indices.data(), indices.size()));
+
+    if (stats && !lodStarts.empty()) {
+        stats->after = analyzeVertexCache(indices.data(), lodEnd(0), vertices.size(), cacheSize);
+    }
+}
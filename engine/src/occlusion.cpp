@@ -0,0 +1,256 @@
+#include "ygg/occlusion.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define YGG_OCCLUSION_SSE 1
+#endif
+
+void Ygg::OcclusionCuller::init(uint32_t width_, uint32_t height_, JobSystem *jobs_) {
+    width = (std::max(width_, 4u) + 3) & ~3u;
+    height = std::max(height_, 1u);
+    tilesX = (width + TileWidth - 1) / TileWidth;
+    tilesY = (height + TileHeight - 1) / TileHeight;
+    bins.assign(tilesX * tilesY, {});
+
+    jobs = jobs_;
+
+    levels.clear();
+    levelSizes.clear();
+    uint32_t w = width, h = height;
+    while (true) {
+        levels.emplace_back(size_t(w) * h, 1.0f);
+        levelSizes.emplace_back(w, h);
+        if (w == 1 && h == 1) break;
+        w = std::max(1u, (w + 1) / 2);
+        h = std::max(1u, (h + 1) / 2);
+    }
+}
+
+void Ygg::OcclusionCuller::beginFrame(const glm::mat4 &viewProjection_) {
+    viewProjection = viewProjection_;
+    triangles.clear();
+    for (std::vector<float> &level : levels) std::fill(level.begin(), level.end(), 1.0f);
+}
+
+void Ygg::OcclusionCuller::addOccluder(const glm::vec3 *positions, size_t vertexCount, const uint32_t *indices,
+                                       size_t indexCount, const glm::mat4 &model) {
+    glm::mat4 transform = viewProjection * model;
+    std::vector<glm::vec4> clip(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) clip[i] = transform * glm::vec4(positions[i], 1.0f);
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        addClipTriangle(clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]);
+    }
+}
+
+void Ygg::OcclusionCuller::addOccluderBox(const glm::vec3 &min, const glm::vec3 &max, const glm::mat4 &model) {
+    static const uint32_t boxIndices[36] = {
+        0,1,2, 2,3,0,  4,5,6, 6,7,4,
+        0,4,7, 7,3,0,  1,5,6, 6,2,1,
+        0,1,5, 5,4,0,  3,2,6, 6,7,3
+    };
+    glm::vec3 corners[8] = {
+        {min.x, min.y, min.z}, {max.x, min.y, min.z}, {max.x, max.y, min.z}, {min.x, max.y, min.z},
+        {min.x, min.y, max.z}, {max.x, min.y, max.z}, {max.x, max.y, max.z}, {min.x, max.y, max.z}
+    };
+    addOccluder(corners, 8, boxIndices, 36, model);
+}
+
+// Clips against the near plane (z >= -w) and stores the result in screen space. The other planes
+// are handled by clamping to the screen while rasterising.
+void Ygg::OcclusionCuller::addClipTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c) {
+    const glm::vec4 in[3] = {a, b, c};
+    glm::vec4 out[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        const glm::vec4 &p = in[i], &q = in[(i + 1) % 3];
+        float dp = p.z + p.w, dq = q.z + q.w;
+        if (dp >= 0.0f) out[count++] = p;
+        if ((dp >= 0.0f) != (dq >= 0.0f)) out[count++] = p + (q - p) * (dp / (dp - dq));
+    }
+    if (count < 3) return;
+
+    glm::vec3 screen[4];
+    for (int i = 0; i < count; i++) {
+        float invW = 1.0f / std::max(out[i].w, 1e-7f);
+        screen[i] = glm::vec3((out[i].x * invW * 0.5f + 0.5f) * float(width),
+                              (out[i].y * invW * 0.5f + 0.5f) * float(height),
+                              out[i].z * invW * 0.5f + 0.5f);
+    }
+    triangles.push_back({{screen[0], screen[1], screen[2]}});
+    if (count == 4) triangles.push_back({{screen[0], screen[2], screen[3]}});
+}
+
+void Ygg::OcclusionCuller::rasterize() {
+    for (std::vector<uint32_t> &bin : bins) bin.clear();
+
+    // bin every triangle into the tiles its bounding box touches
+    for (size_t t = 0; t < triangles.size(); t++) {
+        const glm::vec3 *v = triangles[t].v;
+        float minX = std::min(v[0].x, std::min(v[1].x, v[2].x));
+        float maxX = std::max(v[0].x, std::max(v[1].x, v[2].x));
+        float minY = std::min(v[0].y, std::min(v[1].y, v[2].y));
+        float maxY = std::max(v[0].y, std::max(v[1].y, v[2].y));
+        if (maxX < 0.0f || maxY < 0.0f || minX >= float(width) || minY >= float(height)) continue;
+
+        uint32_t tx0 = uint32_t(std::max(minX, 0.0f)) / TileWidth;
+        uint32_t ty0 = uint32_t(std::max(minY, 0.0f)) / TileHeight;
+        uint32_t tx1 = std::min(uint32_t(std::min(maxX, float(width - 1))) / TileWidth, tilesX - 1);
+        uint32_t ty1 = std::min(uint32_t(std::min(maxY, float(height - 1))) / TileHeight, tilesY - 1);
+        for (uint32_t ty = ty0; ty <= ty1; ty++) {
+            for (uint32_t tx = tx0; tx <= tx1; tx++) bins[ty * tilesX + tx].push_back(uint32_t(t));
+        }
+    }
+
+    // tiles never share pixels, so each one is an independent job; a few triangles aren't worth
+    // handing out
+    const uint32_t tileCount = tilesX * tilesY;
+    auto rasterizeTiles = [&](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++) rasterizeTile(static_cast<uint32_t>(tile));
+    };
+    if (jobs && triangles.size() > 64) {
+        jobs->parallelFor(tileCount, 1, rasterizeTiles);
+    } else {
+        rasterizeTiles(0, tileCount);
+    }
+
+    buildPyramid();
+}
+
+void Ygg::OcclusionCuller::rasterizeTile(uint32_t tile) {
+    const uint32_t tileX0 = (tile % tilesX) * TileWidth;
+    const uint32_t tileY0 = (tile / tilesX) * TileHeight;
+    const uint32_t tileX1 = std::min(tileX0 + TileWidth, width);
+    const uint32_t tileY1 = std::min(tileY0 + TileHeight, height);
+    float *depth = levels[0].data();
+
+    for (uint32_t t : bins[tile]) {
+        glm::vec3 v0 = triangles[t].v[0], v1 = triangles[t].v[1], v2 = triangles[t].v[2];
+
+        // both windings are drawn; make the area positive so "inside" is always e >= 0
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+        if (area == 0.0f) continue;
+        if (area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+        float invArea = 1.0f / area;
+
+        // e_i(x, y) = a_i * x + b_i * y + c_i is the barycentric weight of vertex i times area
+        float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+        float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+        float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+        // depth = z0 + dz1 * e1 + dz2 * e2, with the area folded into the deltas
+        float dz1 = (v1.z - v0.z) * invArea, dz2 = (v2.z - v0.z) * invArea;
+
+        float minX = std::min(v0.x, std::min(v1.x, v2.x)), maxX = std::max(v0.x, std::max(v1.x, v2.x));
+        float minY = std::min(v0.y, std::min(v1.y, v2.y)), maxY = std::max(v0.y, std::max(v1.y, v2.y));
+        int x0 = std::max(int(tileX0), int(std::floor(minX))) & ~3;
+        int x1 = std::min(int(tileX1) - 1, int(std::ceil(maxX)));
+        int y0 = std::max(int(tileY0), int(std::floor(minY)));
+        int y1 = std::min(int(tileY1) - 1, int(std::ceil(maxY)));
+
+        for (int y = y0; y <= y1; y++) {
+            float py = float(y) + 0.5f;
+            float *row = depth + size_t(y) * width;
+            int x = x0;
+#ifdef YGG_OCCLUSION_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 va0 = _mm_set1_ps(a0), va1 = _mm_set1_ps(a1), va2 = _mm_set1_ps(a2);
+            const __m128 rowE0 = _mm_set1_ps(b0 * py + c0);
+            const __m128 rowE1 = _mm_set1_ps(b1 * py + c1);
+            const __m128 rowE2 = _mm_set1_ps(b2 * py + c2);
+            const __m128 vz0 = _mm_set1_ps(v0.z), vdz1 = _mm_set1_ps(dz1), vdz2 = _mm_set1_ps(dz2);
+            // x0 is 4-aligned and tiles are multiples of 4 wide, so every group stays in the tile
+            for (; x <= x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), laneOffsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(va0, px), rowE0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(va1, px), rowE1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(va2, px), rowE2);
+                __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero),
+                                           _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                __m128 z = _mm_add_ps(vz0, _mm_add_ps(_mm_mul_ps(vdz1, e1), _mm_mul_ps(vdz2, e2)));
+                __m128 current = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(current, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+            }
+#endif
+            for (; x <= x1; x++) {
+                float px = float(x) + 0.5f;
+                float e0 = a0 * px + b0 * py + c0;
+                float e1 = a1 * px + b1 * py + c1;
+                float e2 = a2 * px + b2 * py + c2;
+                if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) continue;
+                row[x] = std::min(row[x], v0.z + dz1 * e1 + dz2 * e2);
+            }
+        }
+    }
+}
+
+void Ygg::OcclusionCuller::buildPyramid() {
+    for (size_t l = 1; l < levels.size(); l++) {
+        const std::vector<float> &src = levels[l - 1];
+        std::vector<float> &dst = levels[l];
+        glm::uvec2 srcSize = levelSizes[l - 1], dstSize = levelSizes[l];
+
+        for (uint32_t y = 0; y < dstSize.y; y++) {
+            uint32_t sy0 = std::min(2 * y, srcSize.y - 1), sy1 = std::min(2 * y + 1, srcSize.y - 1);
+            for (uint32_t x = 0; x < dstSize.x; x++) {
+                uint32_t sx0 = std::min(2 * x, srcSize.x - 1), sx1 = std::min(2 * x + 1, srcSize.x - 1);
+                dst[size_t(y) * dstSize.x + x] = std::max(
+                    std::max(src[size_t(sy0) * srcSize.x + sx0], src[size_t(sy0) * srcSize.x + sx1]),
+                    std::max(src[size_t(sy1) * srcSize.x + sx0], src[size_t(sy1) * srcSize.x + sx1]));
+            }
+        }
+    }
+}
+
+bool Ygg::OcclusionCuller::isVisible(const glm::vec3 &min, const glm::vec3 &max) const {
+    if (levels.empty()) return true;
+
+    glm::vec2 screenMin = glm::vec2(static_cast<float>(width), static_cast<float>(height));
+    glm::vec2 screenMax(0.0f);
+    float nearest = 1.0f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z, 1.0f);
+        glm::vec4 clip = viewProjection * corner;
+        // crossing the near plane: the projected rectangle is unbounded
+        if (clip.z < -clip.w || clip.w <= 0.0f) return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen((ndc.x * 0.5f + 0.5f) * float(width), (ndc.y * 0.5f + 0.5f) * float(height));
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+
+    if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= float(width) || screenMin.y >= float(height)) {
+        return false;
+    }
+    int left = std::max(0, int(std::floor(screenMin.x))), right = std::min(int(width) - 1, int(screenMax.x));
+    int bottom = std::max(0, int(std::floor(screenMin.y))), top = std::min(int(height) - 1, int(screenMax.y));
+
+    // the level where the rectangle spans at most two texels each way
+    int extent = std::max(right - left, top - bottom) + 1;
+    unsigned int level = 0;
+    while ((extent >> level) > 2 && level + 1 < levels.size()) level++;
+
+    const std::vector<float> &depth = levels[level];
+    const glm::uvec2 size = levelSizes[level];
+    for (int y = bottom >> level; y <= (top >> level); y++) {
+        for (int x = left >> level; x <= (right >> level); x++) {
+            if (nearest <= depth[size_t(y) * size.x + x]) return true;
+        }
+    }
+    return false;
+}
+
+bool Ygg::OcclusionCuller::isSphereVisible(const glm::vec4 &sphere) const {
+    glm::vec3 center(sphere);
+    return isVisible(center - glm::vec3(sphere.w), center + glm::vec3(sphere.w));
+}
@@ -0,0 +1,420 @@
+#include "ygg/render_queue.hpp"
+#include "ygg/engine.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// packets per job in the passes of flush; below this a frame stays on one thread
+constexpr size_t ParallelGrain = 4096;
+
+} // namespace
+
+void Ygg::StandardUniforms::resolve(const Shader &program) {
+    model = program.getUniform("model");
+    normalMatrix = program.getUniform("normalMatrix");
+    objectColor = program.getUniform("objectColor");
+}
+
+void Ygg::bindInstanceAttributes(GLuint buffer, GLintptr offset) {
+    // the model mat4 takes four vec4 slots (3-6), the normal matrix three vec3 slots (7-9) read
+    // from its padded vec4 columns, colour slot 10
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (unsigned int i = 0; i < 4; i++) {
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(offset + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+    }
+    for (unsigned int i = 0; i < 3; i++) {
+        glVertexAttribPointer(7 + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(offset + offsetof(InstanceData, normal) + i * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (void*)(offset + offsetof(InstanceData, color)));
+}
+
+void Ygg::DrawRecorder::clear() {
+    packets.clear();
+    models.clear();
+    colors.clear();
+    sphereX.clear();
+    sphereY.clear();
+    sphereZ.clear();
+    sphereRadius.clear();
+    programs.clear();
+}
+
+void Ygg::RenderQueue::begin(const glm::mat4 &view_, const glm::mat4 &projection) {
+    view = view_;
+    projectionY = projection[1][1];
+    frustum = Frustum::fromMatrix(projection * view_);
+    reset();
+}
+
+void Ygg::RenderQueue::reset() {
+    direct.clear();
+    for (size_t i = 0; i < recordersUsed; i++) recorders[i]->clear();
+    recordersUsed = 0;
+    packets.clear();
+    models.clear();
+    colors.clear();
+    programs.clear();
+}
+
+size_t Ygg::RenderQueue::size() const {
+    size_t count = direct.size();
+    for (size_t i = 0; i < recordersUsed; i++) count += recorders[i]->size();
+    return count;
+}
+
+uint8_t Ygg::RenderQueue::programSlot(GLuint program) {
+    for (size_t i = 0; i < programs.size(); i++) {
+        if (programs[i] == program) return static_cast<uint8_t>(i);
+    }
+    programs.push_back(program);
+    // more than 256 programs in a frame only costs grouping quality, never correctness
+    return static_cast<uint8_t>(std::min<size_t>(programs.size() - 1, 0xFF));
+}
+
+void Ygg::RenderQueue::forEach(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body) {
+    if (jobs) {
+        jobs->parallelFor(count, grain, body);
+    } else if (count) {
+        body(0, count);
+    }
+}
+
+uint64_t Ygg::RenderQueue::makeKey(uint8_t programSlot, GLuint VAO, GeometryHandle geometry, unsigned int lod,
+                                   uint16_t material, float depth) {
+    // positive floats order the same as their bit patterns, so the top bits give a monotonic
+    // depth without needing the far plane
+    uint32_t depthBits;
+    depth = std::max(depth, 0.0f);
+    std::memcpy(&depthBits, &depth, sizeof(depthBits));
+
+    // pooled meshes share a handful of VAOs, so the VAO only needs a few bits; the geometry
+    // field keeps draws of the same mesh adjacent for batching, split by LOD since each level is
+    // its own index range
+    return (uint64_t(programSlot) << 56)
+         | (uint64_t(VAO & 0xFF) << 48)
+         | (uint64_t(geometry & 0x1FFF) << 35)
+         | (uint64_t(lod & 0x7) << 32)
+         | (uint64_t(material & 0xFFF) << 20)
+         | uint64_t(depthBits >> 11);
+}
+
+void Ygg::DrawRecorder::push(Shader &program, Shader *instancedProgram, const Mesh &mesh, const GeometryRange &range,
+                             const glm::mat4 &model, const glm::vec3 &color, const glm::vec4 &sphere,
+                             uint16_t material, uint8_t *lodState) {
+    // view-space distance of the bounds centre; opaque draws go front to back inside a state run
+    glm::vec4 viewPos = queue.view * glm::vec4(glm::vec3(sphere), 1.0f);
+
+    // the program that will actually be bound decides the slot
+    bool batched = queue.submitMode == SubmitMode::Batched && instancedProgram;
+    const Shader &bound = batched ? *instancedProgram : program;
+    size_t local = std::find(programs.begin(), programs.end(), bound.ID) - programs.begin();
+    if (local == programs.size()) programs.push_back(bound.ID);
+
+    unsigned int lod = 0;
+    if (mesh.lodCount > 1) {
+        // world units per local unit, from how much the model scaled the bounds
+        float scale = mesh.bounds.radius > 0.0f ? sphere.w / mesh.bounds.radius : 1.0f;
+        float distance = glm::length(glm::vec3(viewPos)) - sphere.w;
+        float ppu = pixelsPerUnit(queue.projectionY, queue.lodViewportHeight, distance) * scale;
+        lod = selectLod(mesh.lods, mesh.lodCount, ppu, lodState ? *lodState : 0, queue.lodBudget,
+                        queue.lodHysteresis);
+        // selected before culling, so an object's hysteresis doesn't depend on whether it was in view
+        if (lodState) *lodState = static_cast<uint8_t>(lod);
+    }
+
+    DrawPacket packet;
+    packet.key = RenderQueue::makeKey(static_cast<uint8_t>(std::min<size_t>(local, 0xFF)), mesh.VAO, mesh.geometry,
+                                      lod, material, -viewPos.z);
+    packet.program = &program;
+    packet.instancedProgram = instancedProgram;
+    packet.VAO = mesh.VAO;
+    packet.indexCount = static_cast<GLsizei>(mesh.lods[lod].indexCount);
+    packet.indexType = mesh.indexType;
+    packet.baseVertex = static_cast<GLint>(range.firstVertex);
+    packet.indexOffset = range.indexOffset + mesh.lods[lod].indexOffset;
+    packet.transform = static_cast<uint32_t>(models.size());
+    packets.push_back(packet);
+    models.push_back(model);
+    colors.push_back(color);
+    sphereX.push_back(sphere.x);
+    sphereY.push_back(sphere.y);
+    sphereZ.push_back(sphere.z);
+    sphereRadius.push_back(sphere.w);
+}
+
+void Ygg::RenderQueue::push(Shader &program, Shader *instancedProgram, const Mesh &mesh, const GeometryRange &range,
+                           const glm::mat4 &model, const glm::vec3 &color, const glm::vec4 &sphere,
+                           uint16_t material, uint8_t *lodState) {
+    direct.push(program, instancedProgram, mesh, range, model, color, sphere, material, lodState);
+}
+
+void Ygg::RenderQueue::record(size_t count, size_t grain,
+                             const std::function<void(DrawRecorder&, size_t, size_t)> &body) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    const size_t first = recordersUsed;
+    const size_t chunks = (count + grain - 1) / grain;
+    while (recorders.size() < first + chunks) recorders.emplace_back(new DrawRecorder(*this));
+    recordersUsed += chunks;
+
+    // parallelFor cuts at multiples of grain, so each chunk has a recorder to itself
+    forEach(count, grain, [&](size_t begin, size_t end) { body(*recorders[first + begin / grain], begin, end); });
+}
+
+void Ygg::RenderQueue::cull(MergeTask &task) const {
+    DrawRecorder &recorder = *task.recorder;
+    const size_t count = task.end - task.begin;
+    uint8_t *visible = recorder.visible.data() + task.begin;
+    if (!culling) {
+        std::memset(visible, 1, count);
+        return;
+    }
+
+    size_t kept = cullSpheres(frustum, recorder.sphereX.data() + task.begin, recorder.sphereY.data() + task.begin,
+                              recorder.sphereZ.data() + task.begin, recorder.sphereRadius.data() + task.begin,
+                              count, visible);
+    task.culled = static_cast<uint32_t>(count - kept);
+    if (!occlusion) return;
+    for (size_t i = 0; i < count; i++) {
+        if (!visible[i]) continue;
+        size_t r = task.begin + i;
+        glm::vec4 sphere(recorder.sphereX[r], recorder.sphereY[r], recorder.sphereZ[r], recorder.sphereRadius[r]);
+        if (!occlusion->isSphereVisible(sphere)) {
+            visible[i] = 0;
+            task.occluded++;
+        }
+    }
+}
+
+void Ygg::RenderQueue::merge() {
+    // program slots are assigned in recorder order, so keys don't depend on how jobs were scheduled
+    tasks.clear();
+    auto addTasks = [&](DrawRecorder &recorder) {
+        recorder.slots.resize(recorder.programs.size());
+        for (size_t i = 0; i < recorder.programs.size(); i++) recorder.slots[i] = programSlot(recorder.programs[i]);
+        recorder.visible.resize(recorder.packets.size());
+        for (size_t begin = 0; begin < recorder.packets.size(); begin += ParallelGrain) {
+            size_t end = std::min(recorder.packets.size(), begin + ParallelGrain);
+            tasks.push_back({&recorder, uint32_t(begin), uint32_t(end), 0, 0, 0});
+        }
+    };
+    addTasks(direct);
+    for (size_t i = 0; i < recordersUsed; i++) addTasks(*recorders[i]);
+
+    forEach(tasks.size(), 1, [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; t++) cull(tasks[t]);
+    });
+    size_t total = 0;
+    for (MergeTask &task : tasks) {
+        task.output = static_cast<uint32_t>(total);
+        total += task.end - task.begin - task.culled - task.occluded;
+        stats.culled += task.culled;
+        stats.occluded += task.occluded;
+    }
+
+    // every task copies its survivors to its own range, renumbering transforms and program slots
+    packets.resize(total);
+    models.resize(total);
+    colors.resize(total);
+    normals.resize(total);
+    keys.resize(total);
+    order.resize(total);
+    forEach(tasks.size(), 1, [&](size_t first, size_t last) {
+        for (size_t t = first; t < last; t++) {
+            const MergeTask &task = tasks[t];
+            const DrawRecorder &recorder = *task.recorder;
+            uint32_t out = task.output;
+            for (uint32_t i = task.begin; i < task.end; i++) {
+                if (!recorder.visible[i]) continue;
+                DrawPacket packet = recorder.packets[i];
+                uint64_t slot = recorder.slots[packet.key >> 56];
+                packet.key = (packet.key & ~(uint64_t(0xFF) << 56)) | (slot << 56);
+                packet.transform = out;
+                packets[out] = packet;
+                models[out] = recorder.models[i];
+                colors[out] = recorder.colors[i];
+                keys[out] = packet.key;
+                order[out] = out;
+                out++;
+            }
+            computeNormalMatrices(models.data() + task.output, out - task.output, normals.data() + task.output);
+        }
+    });
+}
+
+void Ygg::RenderQueue::sortKeys() {
+    // merge() filled keys and order
+    radixSortKeys(keys, order, keysScratch, orderScratch);
+}
+
+void Ygg::radixSortKeys(std::vector<uint64_t> &keys, std::vector<uint32_t> &order,
+                        std::vector<uint64_t> &keysScratch, std::vector<uint32_t> &orderScratch) {
+    const size_t n = keys.size();
+    if (n == 0) return;
+    keysScratch.resize(n);
+    orderScratch.resize(n);
+
+    // LSD radix sort, 8 bits per pass. Passes where every key shares the same byte are skipped,
+    // which is common for the program byte and the high depth bits.
+    for (unsigned int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (size_t i = 0; i < n; i++) histogram[(keys[i] >> shift) & 0xFF]++;
+        if (histogram[(keys[0] >> shift) & 0xFF] == n) continue;
+
+        size_t offset = 0;
+        for (size_t b = 0; b < 256; b++) {
+            size_t count = histogram[b];
+            histogram[b] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            size_t dst = histogram[(keys[i] >> shift) & 0xFF]++;
+            keysScratch[dst] = keys[i];
+            orderScratch[dst] = order[i];
+        }
+        keys.swap(keysScratch);
+        order.swap(orderScratch);
+    }
+}
+
+void Ygg::RenderQueue::flush() {
+    stats = {};
+    merge();
+    if (!packets.empty()) {
+        sortKeys();
+        if (submitMode == SubmitMode::Batched) {
+            submitBatched();
+            instanceStream.endFrame();
+        } else {
+            submitImmediate();
+        }
+        glBindVertexArray(0);
+    }
+    stats.objects = static_cast<unsigned int>(packets.size());
+    reset();
+}
+
+void Ygg::RenderQueue::submitImmediate() {
+    GLuint currentProgram = 0;
+    GLuint currentVAO = 0;
+    StandardUniforms uniforms;
+    for (uint32_t index : order) {
+        const DrawPacket &packet = packets[index];
+
+        if (packet.program->ID != currentProgram) {
+            packet.program->use();
+            uniforms.resolve(*packet.program);
+            currentProgram = packet.program->ID;
+            stats.programBinds++;
+        }
+        if (packet.VAO != currentVAO) {
+            glBindVertexArray(packet.VAO);
+            currentVAO = packet.VAO;
+            stats.vaoBinds++;
+        }
+
+        packet.program->setMat4(uniforms.model, models[packet.transform]);
+        packet.program->setMat3(uniforms.normalMatrix, normals[packet.transform].toMat3());
+        packet.program->setVec3(uniforms.objectColor, colors[packet.transform]);
+        glDrawElementsBaseVertex(GL_TRIANGLES, packet.indexCount, packet.indexType,
+                                 (void*)(uintptr_t)packet.indexOffset, packet.baseVertex);
+        stats.drawCalls++;
+    }
+}
+
+bool Ygg::RenderQueue::uploadInstances(GLintptr &base) {
+    if (!instanceStream.isInitialized()) {
+        instanceStream.init(GL_ARRAY_BUFFER, std::max<size_t>(order.size(), 1024) * sizeof(InstanceData));
+    }
+
+    // per-draw records in submission order, so every run reads a contiguous slice
+    InstanceData *instances = static_cast<InstanceData*>(
+        instanceStream.map(order.size() * sizeof(InstanceData), 16, base));
+    if (!instances) return false;
+    forEach(order.size(), ParallelGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            uint32_t t = packets[order[i]].transform;
+            instances[i].model = models[t];
+            instances[i].normal = normals[t];
+            instances[i].color = glm::vec4(colors[t], 1.0f);
+        }
+    });
+    instanceStream.unmap();
+    return true;
+}
+
+void Ygg::RenderQueue::submitBatched() {
+    // without instance data every packet still has its per-draw uniforms
+    GLintptr base;
+    if (!uploadInstances(base)) {
+        submitImmediate();
+        return;
+    }
+
+    GLuint currentProgram = 0;
+    GLuint currentVAO = 0;
+    StandardUniforms uniforms;
+    size_t i = 0;
+    while (i < order.size()) {
+        const DrawPacket &first = packets[order[i]];
+
+        // packets without an instanced variant are drawn one by one with the per-draw uniforms
+        if (!first.instancedProgram) {
+            if (first.program->ID != currentProgram) {
+                first.program->use();
+                uniforms.resolve(*first.program);
+                currentProgram = first.program->ID;
+                stats.programBinds++;
+            }
+            if (first.VAO != currentVAO) {
+                glBindVertexArray(first.VAO);
+                currentVAO = first.VAO;
+                stats.vaoBinds++;
+            }
+            first.program->setMat4(uniforms.model, models[first.transform]);
+            first.program->setMat3(uniforms.normalMatrix, normals[first.transform].toMat3());
+            first.program->setVec3(uniforms.objectColor, colors[first.transform]);
+            glDrawElementsBaseVertex(GL_TRIANGLES, first.indexCount, first.indexType,
+                                     (void*)(uintptr_t)first.indexOffset, first.baseVertex);
+            stats.drawCalls++;
+            i++;
+            continue;
+        }
+
+        // extend the run over every following packet that draws the same geometry the same way
+        size_t end = i + 1;
+        while (end < order.size()) {
+            const DrawPacket &next = packets[order[end]];
+            if (next.instancedProgram != first.instancedProgram || next.VAO != first.VAO ||
+                next.baseVertex != first.baseVertex || next.indexOffset != first.indexOffset ||
+                next.indexCount != first.indexCount || next.indexType != first.indexType) break;
+            end++;
+        }
+
+        if (first.instancedProgram->ID != currentProgram) {
+            first.instancedProgram->use();
+            currentProgram = first.instancedProgram->ID;
+            stats.programBinds++;
+        }
+        if (first.VAO != currentVAO) {
+            glBindVertexArray(first.VAO);
+            currentVAO = first.VAO;
+            stats.vaoBinds++;
+        }
+
+        // base the instance attributes at the run's first record; gl_InstanceID indexes from there
+        bindInstanceAttributes(instanceStream.buffer(), base + GLintptr(i * sizeof(InstanceData)));
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, first.indexCount, first.indexType,
+                                          (void*)(uintptr_t)first.indexOffset, GLsizei(end - i), first.baseVertex);
+        stats.drawCalls++;
+        i = end;
+    }
+}
+
+void Ygg::RenderQueue::destroy() {
+    instanceStream.destroy();
+}
@@ -0,0 +1,167 @@
+#include "ygg/renderables.hpp"
+#include "ygg/engine.hpp"
+#include "ygg/transform.hpp"
+#include <algorithm>
+
+namespace {
+
+// entities per job
+constexpr size_t ParallelGrain = 4096;
+
+void forRange(Ygg::JobSystem *jobs, size_t count, const std::function<void(size_t, size_t)> &body) {
+    if (jobs) {
+        jobs->parallelFor(count, ParallelGrain, body);
+    } else {
+        body(0, count);
+    }
+}
+
+} // namespace
+
+void Ygg::packRenderables(RenderRegistry &registry) {
+    const ComponentPool<MeshRef> &meshes = registry.pool<MeshRef>();
+    registry.pool<Transform>().sortAs(meshes);
+    registry.pool<Material>().sortAs(meshes);
+    registry.pool<WorldBounds>().sortAs(meshes);
+    registry.pool<Visibility>().sortAs(meshes);
+    registry.pool<SceneNode>().sortAs(meshes);
+}
+
+void Ygg::updateTransforms(RenderRegistry &registry, const SceneGraph &scene, JobSystem *jobs) {
+    ComponentPool<SceneNode> &nodes = registry.pool<SceneNode>();
+    ComponentPool<Transform> &transforms = registry.pool<Transform>();
+    forRange(jobs, nodes.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Entity entity = nodes.entities()[i];
+            const SceneNode &node = nodes.data()[i];
+            Transform *transform = transforms.at(i, entity);
+            if (!transform || !scene.isAlive(node.node)) continue;
+            transform->model = multiplyTransform(scene.getWorld(node.node), node.offset);
+        }
+    });
+}
+
+void Ygg::updateBounds(RenderRegistry &registry, DynamicBvh &bvh, JobSystem *jobs) {
+    ComponentPool<MeshRef> &meshes = registry.pool<MeshRef>();
+    ComponentPool<Transform> &transforms = registry.pool<Transform>();
+    ComponentPool<WorldBounds> &bounds = registry.pool<WorldBounds>();
+
+    // adding components isn't thread safe, so renderables without bounds get them first
+    for (size_t i = 0; i < meshes.size(); i++) {
+        if (!bounds.at(i, meshes.entities()[i])) registry.add<WorldBounds>(meshes.entities()[i]);
+    }
+
+    forRange(jobs, meshes.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Entity entity = meshes.entities()[i];
+            const Mesh *mesh = meshes.data()[i].mesh;
+            const Transform *transform = transforms.at(i, entity);
+            if (!mesh || !transform) continue;
+            WorldBounds *world = bounds.at(i, entity);
+            world->sphere = transformSphere(mesh->bounds, transform->model);
+            transformAabb(mesh->bounds, transform->model, world->min, world->max);
+        }
+    });
+
+    for (size_t i = 0; i < meshes.size(); i++) {
+        Entity entity = meshes.entities()[i];
+        if (!meshes.data()[i].mesh || !transforms.at(i, entity)) continue;
+        WorldBounds *world = bounds.at(i, entity);
+        Aabb box;
+        box.min = world->min;
+        box.max = world->max;
+        if (world->proxy == DynamicBvh::NullNode) {
+            world->proxy = bvh.insert(box, entity);
+        } else {
+            bvh.move(world->proxy, box);
+        }
+    }
+}
+
+size_t Ygg::cullRenderables(RenderRegistry &registry, const DynamicBvh &bvh, const Frustum &frustum,
+                            std::vector<uint32_t> &scratch) {
+    ComponentPool<Visibility> &visibility = registry.pool<Visibility>();
+    for (size_t i = 0; i < visibility.size(); i++) visibility.data()[i].visible = false;
+
+    scratch.clear();
+    bvh.queryFrustum(frustum, scratch);
+    size_t visible = 0;
+    for (uint32_t entity : scratch) {
+        Visibility *v = visibility.tryGet(entity);
+        if (!v) continue;
+        v->visible = true;
+        visible++;
+    }
+    return visible;
+}
+
+Ygg::Entity Ygg::pickRenderable(RenderRegistry &registry, const DynamicBvh &bvh, const glm::vec3 &origin,
+                                const glm::vec3 &direction, float maxDistance, float *distance) {
+    std::vector<RayHit> hits;
+    bvh.queryRay(origin, direction, maxDistance, hits);
+
+    // hits are sorted by where the ray enters the fat boxes, which may be well before the real ones
+    Entity nearest = 0;
+    float nearestDistance = maxDistance;
+    for (const RayHit &hit : hits) {
+        if (hit.distance > nearestDistance) break;
+        const WorldBounds *world = registry.tryGet<WorldBounds>(hit.userData);
+        const Visibility *v = registry.tryGet<Visibility>(hit.userData);
+        if (!world || (v && v->hidden)) continue;
+        Aabb box;
+        box.min = world->min;
+        box.max = world->max;
+        float t = intersectRay(box, origin, direction, nearestDistance);
+        if (t >= 0.0f && (!nearest || t < nearestDistance)) {
+            nearest = hit.userData;
+            nearestDistance = t;
+        }
+    }
+    if (nearest && distance) *distance = nearestDistance;
+    return nearest;
+}
+
+void Ygg::queryRenderables(RenderRegistry &registry, const DynamicBvh &bvh, const Aabb &region,
+                           std::vector<Entity> &out) {
+    size_t first = out.size();
+    bvh.queryAabb(region, out);
+    // the BVH compares fat boxes; keep the entities whose own box overlaps
+    auto end = std::remove_if(out.begin() + first, out.end(), [&](Entity entity) {
+        const WorldBounds *world = registry.tryGet<WorldBounds>(entity);
+        if (!world) return true;
+        Aabb box;
+        box.min = world->min;
+        box.max = world->max;
+        return !box.overlaps(region);
+    });
+    out.erase(end, out.end());
+}
+
+void Ygg::buildDrawList(RenderRegistry &registry, RenderEngine &engine) {
+    ComponentPool<MeshRef> &meshes = registry.pool<MeshRef>();
+    ComponentPool<Transform> &transforms = registry.pool<Transform>();
+    ComponentPool<Material> &materials = registry.pool<Material>();
+    ComponentPool<Visibility> &visibility = registry.pool<Visibility>();
+    engine.recordMeshes(meshes.size(), ParallelGrain, [&](MeshRecorder &recorder, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Entity entity = meshes.entities()[i];
+            MeshRef &ref = meshes.data()[i];
+            const Mesh *mesh = ref.mesh;
+            const Transform *transform = transforms.at(i, entity);
+            const Visibility *v = visibility.at(i, entity);
+            if (!mesh || !transform || (v && (v->hidden || !v->visible))) continue;
+
+            const Material *material = materials.at(i, entity);
+            recorder.submit(*mesh, transform->model, material ? material->color : mesh->color,
+                            material ? material->id : 0, &ref.lod);
+        }
+    });
+}
+
+void Ygg::destroyRenderable(RenderRegistry &registry, DynamicBvh &bvh, Entity entity) {
+    if (!registry.isAlive(entity)) return;
+    if (WorldBounds *world = registry.tryGet<WorldBounds>(entity)) {
+        if (world->proxy != DynamicBvh::NullNode) bvh.remove(world->proxy);
+    }
+    registry.destroy(entity);
+}
@@ -0,0 +1,184 @@
+#include "ygg/scene_graph.hpp"
+#include "ygg/transform.hpp"
+#include <algorithm>
+
+Ygg::NodeHandle Ygg::SceneGraph::create(NodeHandle parent, const glm::mat4 &local) {
+    if (slots.empty()) {
+        // handle 0 stays reserved as "no node"
+        slots.push_back(Dead);
+        parents.push_back(0);
+        dirty.push_back(0);
+    }
+
+    NodeHandle node;
+    if (!freeHandles.empty()) {
+        node = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        node = static_cast<NodeHandle>(slots.size());
+        slots.push_back(Dead);
+        parents.push_back(0);
+        dirty.push_back(0);
+    }
+
+    const uint32_t index = static_cast<uint32_t>(order.size());
+    slots[node] = index;
+    parents[node] = parent;
+    dirty[node] = 0;
+    order.push_back(node);
+    parentIndex.push_back(parent ? slots[parent] : NoParent);
+    subtreeEnd.push_back(index + 1);
+    locals.push_back(local);
+    worlds.push_back(local);
+
+    // appending to the last subtree keeps the order depth first; the ancestors all end here
+    if (parent && !layoutStale) {
+        if (subtreeEnd[slots[parent]] == index) {
+            for (uint32_t p = slots[parent]; p != NoParent; p = parentIndex[p]) subtreeEnd[p] = index + 1;
+        } else {
+            layoutStale = true;
+        }
+    }
+    markDirty(node);
+    return node;
+}
+
+void Ygg::SceneGraph::destroy(NodeHandle node) {
+    if (!isAlive(node)) return;
+    // the subtree is only known to be contiguous in a fresh layout
+    if (layoutStale) relayout();
+
+    uint32_t index = slots[node];
+    for (uint32_t i = index; i < subtreeEnd[index]; i++) {
+        slots[order[i]] = Dead;
+        dirty[order[i]] = 0;
+        freeHandles.push_back(order[i]);
+    }
+    layoutStale = true;
+}
+
+bool Ygg::SceneGraph::setParent(NodeHandle node, NodeHandle parent) {
+    for (NodeHandle p = parent; p; p = parents[p]) {
+        if (p == node) return false;
+    }
+    if (parents[node] == parent) return true;
+    parents[node] = parent;
+    layoutStale = true;
+    markDirty(node);
+    return true;
+}
+
+void Ygg::SceneGraph::setLocal(NodeHandle node, const glm::mat4 &local) {
+    locals[slots[node]] = local;
+    markDirty(node);
+}
+
+void Ygg::SceneGraph::markDirty(NodeHandle node) {
+    if (dirty[node]) return;
+    dirty[node] = 1;
+    dirtyNodes.push_back(node);
+}
+
+size_t Ygg::SceneGraph::update(JobSystem *jobs) {
+    // subtree ranges to recompute, none inside another
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    size_t updated = 0;
+    if (layoutStale) {
+        relayout();
+        for (uint32_t i = 0; i < order.size(); i = subtreeEnd[i]) ranges.emplace_back(i, subtreeEnd[i]);
+    } else {
+        // dirty nodes inside a subtree that is already being recomputed are covered by it
+        std::vector<uint32_t> roots;
+        roots.reserve(dirtyNodes.size());
+        for (NodeHandle node : dirtyNodes) {
+            if (dirty[node] && slots[node] != Dead) roots.push_back(slots[node]);
+        }
+        std::sort(roots.begin(), roots.end());
+        uint32_t covered = 0;
+        for (uint32_t index : roots) {
+            if (index < covered) continue;
+            covered = subtreeEnd[index];
+            ranges.emplace_back(index, covered);
+        }
+    }
+    for (const std::pair<uint32_t, uint32_t> &range : ranges) updated += range.second - range.first;
+
+    auto recompute = [&](size_t first, size_t last) {
+        for (size_t r = first; r < last; r++) {
+            for (uint32_t i = ranges[r].first; i < ranges[r].second; i++) {
+                uint32_t p = parentIndex[i];
+                // parents come first, so theirs is already current
+                worlds[i] = p == NoParent ? locals[i] : multiplyTransform(worlds[p], locals[i]);
+            }
+        }
+    };
+    // a few thousand transforms per job; ranges are usually similar in size (one character each)
+    if (jobs && updated >= 8192) {
+        size_t grain = std::max<size_t>(1, ranges.size() * 2048 / updated);
+        jobs->parallelFor(ranges.size(), grain, recompute);
+    } else {
+        recompute(0, ranges.size());
+    }
+
+    for (NodeHandle node : dirtyNodes) dirty[node] = 0;
+    dirtyNodes.clear();
+    return updated;
+}
+
+void Ygg::SceneGraph::relayout() {
+    // live nodes in their current order, so siblings and roots keep their relative order
+    std::vector<NodeHandle> live;
+    live.reserve(order.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        if (slots[order[i]] == i) live.push_back(order[i]);
+    }
+
+    // children of every handle, as ranges of one array
+    std::vector<uint32_t> childStart(slots.size() + 1, 0);
+    for (NodeHandle node : live) childStart[parents[node] + 1]++;
+    for (size_t h = 0; h < slots.size(); h++) childStart[h + 1] += childStart[h];
+    std::vector<NodeHandle> children(live.size());
+    {
+        std::vector<uint32_t> fill(childStart.begin(), childStart.end() - 1);
+        for (NodeHandle node : live) children[fill[parents[node]]++] = node;
+    }
+
+    std::vector<NodeHandle> newOrder;
+    std::vector<uint32_t> newParentIndex;
+    std::vector<glm::mat4> newLocals, newWorlds;
+    newOrder.reserve(live.size());
+    newParentIndex.reserve(live.size());
+    newLocals.reserve(live.size());
+    newWorlds.reserve(live.size());
+
+    // handle 0 is the parent of every root
+    std::vector<NodeHandle> stack;
+    for (uint32_t c = childStart[1]; c-- > childStart[0];) stack.push_back(children[c]);
+    while (!stack.empty()) {
+        NodeHandle node = stack.back();
+        stack.pop_back();
+        newParentIndex.push_back(parents[node] ? slots[parents[node]] : NoParent);
+        newLocals.push_back(locals[slots[node]]);
+        // world transforms move along, so getWorld() stays that of the last update()
+        newWorlds.push_back(worlds[slots[node]]);
+        slots[node] = static_cast<uint32_t>(newOrder.size());
+        newOrder.push_back(node);
+        for (uint32_t c = childStart[node + 1]; c-- > childStart[node];) stack.push_back(children[c]);
+    }
+
+    // a subtree ends where the last of its children's subtrees ends
+    const uint32_t n = static_cast<uint32_t>(newOrder.size());
+    subtreeEnd.resize(n);
+    for (uint32_t i = 0; i < n; i++) subtreeEnd[i] = i + 1;
+    for (uint32_t i = n; i-- > 0;) {
+        if (newParentIndex[i] != NoParent) {
+            subtreeEnd[newParentIndex[i]] = std::max(subtreeEnd[newParentIndex[i]], subtreeEnd[i]);
+        }
+    }
+
+    order.swap(newOrder);
+    parentIndex.swap(newParentIndex);
+    locals.swap(newLocals);
+    worlds.swap(newWorlds);
+    layoutStale = false;
+}
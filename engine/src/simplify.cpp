@@ -0,0 +1,381 @@
+#include "ygg/simplify.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+// Sum of squared distances to a set of area weighted planes, as the symmetric 4x4 matrix
+// (a b c d)(a b c d)^T without its duplicate entries
+struct Quadric {
+    float a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0, ad = 0, bd = 0, cd = 0, d2 = 0;
+    float weight = 0;
+
+    static Quadric fromPlane(const glm::vec3 &n, float d, float weight) {
+        Quadric q;
+        q.a2 = n.x * n.x * weight; q.b2 = n.y * n.y * weight; q.c2 = n.z * n.z * weight;
+        q.ab = n.x * n.y * weight; q.ac = n.x * n.z * weight; q.bc = n.y * n.z * weight;
+        q.ad = n.x * d * weight;   q.bd = n.y * d * weight;   q.cd = n.z * d * weight;
+        q.d2 = d * d * weight;
+        q.weight = weight;
+        return q;
+    }
+
+    void add(const Quadric &q) {
+        a2 += q.a2; b2 += q.b2; c2 += q.c2; ab += q.ab; ac += q.ac; bc += q.bc;
+        ad += q.ad; bd += q.bd; cd += q.cd; d2 += q.d2;
+        weight += q.weight;
+    }
+
+    // mean squared distance of p to the planes
+    float error(const glm::vec3 &p) const {
+        float e = p.x * p.x * a2 + p.y * p.y * b2 + p.z * p.z * c2
+                + 2.0f * (p.x * p.y * ab + p.x * p.z * ac + p.y * p.z * bc)
+                + 2.0f * (p.x * ad + p.y * bd + p.z * cd) + d2;
+        return weight > 0.0f ? std::max(e, 0.0f) / weight : 0.0f;
+    }
+};
+
+// Area weighted samples of the (scaled) normal and colour around a vertex. error(x) is the mean
+// squared distance of x to the samples, which is what replacing them all with x costs.
+struct AttributeQuadric {
+    glm::vec3 normal = glm::vec3(0.0f), color = glm::vec3(0.0f);
+    float squares = 0, weight = 0;
+
+    void addSample(const glm::vec3 &n, const glm::vec3 &c, float w) {
+        normal += n * w;
+        color += c * w;
+        squares += (glm::dot(n, n) + glm::dot(c, c)) * w;
+        weight += w;
+    }
+
+    void add(const AttributeQuadric &q) {
+        normal += q.normal;
+        color += q.color;
+        squares += q.squares;
+        weight += q.weight;
+    }
+
+    float error(const glm::vec3 &n, const glm::vec3 &c) const {
+        if (weight <= 0.0f) return 0.0f;
+        float e = (glm::dot(n, n) + glm::dot(c, c)) * weight - 2.0f * (glm::dot(n, normal) + glm::dot(c, color))
+                + squares;
+        return std::max(e, 0.0f) / weight;
+    }
+};
+
+enum class VertexKind : uint8_t { Interior, Border, Locked };
+
+struct Collapse {
+    uint32_t from, to;
+    float cost;         // geometric and attribute error, the collapse order
+    float error;        // geometric part, what targetError limits
+};
+
+template <typename T>
+size_t hashBytes(const T &value, size_t seed = 0) {
+    uint32_t words[sizeof(T) / 4];
+    std::memcpy(words, &value, sizeof(words));
+    size_t h = seed;
+    for (uint32_t w : words) h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+    return h;
+}
+
+struct PositionHash {
+    size_t operator()(const glm::vec3 &p) const { return hashBytes(p); }
+};
+
+struct VertexHash {
+    size_t operator()(const Ygg::Vertex &v) const { return hashBytes(v.color, hashBytes(v.normal, hashBytes(v.pos))); }
+};
+
+struct VertexEqual {
+    bool operator()(const Ygg::Vertex &a, const Ygg::Vertex &b) const {
+        return a.pos == b.pos && a.normal == b.normal && a.color == b.color;
+    }
+};
+
+} // namespace
+
+size_t Ygg::simplifyMesh(uint32_t *destination, const uint32_t *indices, size_t indexCount,
+                         const Vertex *vertices, size_t vertexCount, size_t targetIndexCount, float targetError,
+                         float *resultError, const SimplifyOptions &options) {
+    indexCount -= indexCount % 3;
+    if (resultError) *resultError = 0.0f;
+
+    // work in a unit sized space so the error and attribute weights mean the same for every mesh
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    for (size_t i = 0; i < vertexCount; i++) {
+        lo = glm::min(lo, vertices[i].pos);
+        hi = glm::max(hi, vertices[i].pos);
+    }
+    float extent = vertexCount ? std::max(std::max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z) : 0.0f;
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) positions[i] = (vertices[i].pos - lo) * scale;
+
+    // merge exact duplicates, then group by position: a position shared by several remaining
+    // vertices is an attribute seam
+    std::vector<uint32_t> weld(vertexCount), group(vertexCount);
+    std::vector<uint32_t> groupSize;
+    {
+        std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique;
+        std::unordered_map<glm::vec3, uint32_t, PositionHash> groups;
+        unique.reserve(vertexCount);
+        groups.reserve(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            auto inserted = unique.emplace(vertices[i], static_cast<uint32_t>(i));
+            weld[i] = inserted.first->second;
+            if (!inserted.second) continue;
+            auto g = groups.emplace(vertices[i].pos, static_cast<uint32_t>(groupSize.size()));
+            if (g.second) groupSize.push_back(0);
+            group[i] = g.first->second;
+            groupSize[group[i]]++;
+        }
+    }
+
+    std::vector<uint32_t> result(indexCount);
+    for (size_t i = 0; i < indexCount; i++) result[i] = weld[indices[i]];
+
+    // border edges are used by a single triangle; counted on position groups so that seams,
+    // whose sides use different vertices, don't show up as borders
+    std::vector<VertexKind> kind(vertexCount, VertexKind::Interior);
+    std::vector<std::pair<uint64_t, uint32_t>> edges;   // (group pair, vertex) per directed edge
+    edges.reserve(indexCount);
+    auto edgeKey = [&](uint32_t a, uint32_t b) {
+        uint32_t ga = group[a], gb = group[b];
+        return ga < gb ? (uint64_t(ga) << 32) | gb : (uint64_t(gb) << 32) | ga;
+    };
+    auto findBorders = [&](std::vector<uint8_t> *borderEdge) {
+        edges.clear();
+        for (size_t i = 0; i < result.size(); i++) {
+            uint32_t a = result[i], b = result[i - i % 3 + (i + 1) % 3];
+            edges.emplace_back(edgeKey(a, b), static_cast<uint32_t>(i));
+        }
+        std::sort(edges.begin(), edges.end());
+        if (borderEdge) borderEdge->assign(result.size(), 0);
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i + 1;
+            while (j < edges.size() && edges[j].first == edges[i].first) j++;
+            if (j - i == 1 && borderEdge) (*borderEdge)[edges[i].second] = 1;
+            i = j;
+        }
+    };
+
+    std::vector<uint8_t> borderEdge;
+    findBorders(&borderEdge);
+    for (size_t i = 0; i < result.size(); i++) {
+        if (!borderEdge[i]) continue;
+        uint32_t a = result[i], b = result[i - i % 3 + (i + 1) % 3];
+        VertexKind k = options.lockBorder ? VertexKind::Locked : VertexKind::Border;
+        if (kind[a] == VertexKind::Interior) kind[a] = k;
+        if (kind[b] == VertexKind::Interior) kind[b] = k;
+    }
+    for (size_t i = 0; i < vertexCount; i++) {
+        if (weld[i] == i && groupSize[group[i]] > 1) kind[i] = VertexKind::Locked;
+    }
+
+    // plane quadrics of every triangle, plus planes through border edges perpendicular to the
+    // surface when borders may move, so they only slide along themselves
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<AttributeQuadric> attributes(vertexCount);
+    for (size_t t = 0; t < result.size(); t += 3) {
+        uint32_t v[3] = {result[t], result[t + 1], result[t + 2]};
+        glm::vec3 n = glm::cross(positions[v[1]] - positions[v[0]], positions[v[2]] - positions[v[0]]);
+        float area = glm::length(n);
+        if (area <= 0.0f) continue;
+        n /= area;
+        Quadric q = Quadric::fromPlane(n, -glm::dot(n, positions[v[0]]), area);
+        for (int k = 0; k < 3; k++) {
+            quadrics[v[k]].add(q);
+            attributes[v[k]].addSample(vertices[v[k]].normal * options.normalWeight,
+                                       vertices[v[k]].color * options.colorWeight, area);
+            if (!options.lockBorder && borderEdge[t + k]) {
+                uint32_t a = v[k], b = v[(k + 1) % 3];
+                glm::vec3 edge = positions[b] - positions[a];
+                float length = glm::length(edge);
+                if (length <= 0.0f) continue;
+                glm::vec3 side = glm::normalize(glm::cross(edge, n));
+                // weighted like a triangle the edge's length on a side, times 10 to stay put
+                Quadric border = Quadric::fromPlane(side, -glm::dot(side, positions[a]), length * length * 10.0f);
+                quadrics[a].add(border);
+                quadrics[b].add(border);
+            }
+        }
+    }
+
+    const float errorLimit = targetError * scale;
+    float maxError = 0.0f;
+
+    // vertex -> triangles, rebuilt every pass
+    std::vector<uint32_t> offsets(vertexCount + 1), adjacency;
+    std::vector<uint32_t> collapse(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> stamp(vertexCount, 0);
+    uint32_t stampTime = 0;
+    std::vector<Collapse> candidates;
+
+    while (result.size() > targetIndexCount) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (uint32_t v : result) offsets[v + 1]++;
+        for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+        adjacency.resize(result.size());
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+        if (!options.lockBorder) findBorders(&borderEdge);
+
+        auto consider = [&](uint32_t from, uint32_t to, bool onBorder) {
+            if (kind[from] == VertexKind::Locked) return;
+            // border vertices may only follow the border, onto another border (or locked) vertex
+            if (kind[from] == VertexKind::Border && (!onBorder || kind[to] == VertexKind::Interior)) return;
+            Quadric q = quadrics[from];
+            q.add(quadrics[to]);
+            AttributeQuadric a = attributes[from];
+            a.add(attributes[to]);
+            float error = q.error(positions[to]);
+            float attributeError = a.error(vertices[to].normal * options.normalWeight,
+                                           vertices[to].color * options.colorWeight);
+            candidates.push_back({from, to, error + attributeError, error});
+        };
+        candidates.clear();
+        for (size_t i = 0; i < result.size(); i++) {
+            uint32_t a = result[i], b = result[i - i % 3 + (i + 1) % 3];
+            bool onBorder = !options.lockBorder && borderEdge[i];
+            // interior edges show up once per side
+            if (a > b && !onBorder) continue;
+            consider(a, b, onBorder);
+            consider(b, a, onBorder);
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+        for (size_t v = 0; v < vertexCount; v++) collapse[v] = static_cast<uint32_t>(v);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t remaining = result.size();
+        size_t collapsed = 0;
+
+        for (const Collapse &c : candidates) {
+            if (remaining <= targetIndexCount) break;
+            if (c.error > errorLimit * errorLimit) continue;
+            if (touched[c.from] || touched[c.to]) continue;
+
+            // triangles are read through this pass's collapses so far; a triangle that already
+            // lost a vertex is gone
+            auto corner = [&](uint32_t triangle, int k) { return collapse[result[triangle * 3 + k]]; };
+            auto degenerate = [&](uint32_t triangle) {
+                uint32_t a = corner(triangle, 0), b = corner(triangle, 1), d = corner(triangle, 2);
+                return a == b || b == d || a == d;
+            };
+
+            // link condition: from and to may only share the neighbours of the triangles the
+            // collapse removes, otherwise the surface pinches
+            const uint32_t toStamp = ++stampTime;
+            for (uint32_t a = offsets[c.to]; a < offsets[c.to + 1]; a++) {
+                if (degenerate(adjacency[a])) continue;
+                for (int k = 0; k < 3; k++) stamp[corner(adjacency[a], k)] = toStamp;
+            }
+            const uint32_t commonStamp = ++stampTime;
+            size_t shared = 0, common = 0;
+            bool flips = false;
+            for (uint32_t a = offsets[c.from]; a < offsets[c.from + 1] && !flips; a++) {
+                uint32_t t = adjacency[a];
+                if (degenerate(t)) continue;
+                uint32_t v[3] = {corner(t, 0), corner(t, 1), corner(t, 2)};
+                for (uint32_t n : v) {
+                    if (n == c.from || n == c.to || stamp[n] != toStamp) continue;
+                    stamp[n] = commonStamp;
+                    common++;
+                }
+                if (v[0] == c.to || v[1] == c.to || v[2] == c.to) {
+                    shared++;
+                    continue;
+                }
+                // the triangles that stay must keep facing the same way
+                int k = v[0] == c.from ? 0 : v[1] == c.from ? 1 : 2;
+                const glm::vec3 &p1 = positions[v[(k + 1) % 3]];
+                const glm::vec3 &p2 = positions[v[(k + 2) % 3]];
+                glm::vec3 before = glm::cross(p1 - positions[c.from], p2 - positions[c.from]);
+                glm::vec3 after = glm::cross(p1 - positions[c.to], p2 - positions[c.to]);
+                flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+            }
+            if (flips || common > shared) continue;
+
+            collapse[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+            attributes[c.to].add(attributes[c.from]);
+            maxError = std::max(maxError, c.error);
+            // the target's adjacency is stale from here on, so neither end moves again this pass
+            touched[c.from] = 1;
+            touched[c.to] = 1;
+            remaining -= shared * 3;
+            collapsed++;
+        }
+        if (collapsed == 0) break;
+
+        size_t out = 0;
+        for (size_t t = 0; t < result.size(); t += 3) {
+            uint32_t a = collapse[result[t]], b = collapse[result[t + 1]], c = collapse[result[t + 2]];
+            if (a == b || b == c || a == c) continue;
+            result[out++] = a;
+            result[out++] = b;
+            result[out++] = c;
+        }
+        result.resize(out);
+    }
+
+    std::copy(result.begin(), result.end(), destination);
+    if (resultError) *resultError = std::sqrt(maxError) * extent;
+    return result.size();
+}
+
+Ygg::LodChain Ygg::generateLodChain(const Vertex *vertices, size_t vertexCount, const uint32_t *indices,
+                                    size_t indexCount, const LodChainOptions &options) {
+    LodChain chain;
+    chain.indices.emplace_back(indices, indices + indexCount);
+    chain.errors.push_back(0.0f);
+
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    for (size_t i = 0; i < vertexCount; i++) {
+        lo = glm::min(lo, vertices[i].pos);
+        hi = glm::max(hi, vertices[i].pos);
+    }
+    float extent = vertexCount ? std::max(std::max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z) : 0.0f;
+
+    unsigned int maxLods = std::min(options.maxLods, MAX_MESH_LODS);
+    std::vector<uint32_t> level(indexCount);
+    float target = float(indexCount);
+    while (chain.indices.size() < maxLods) {
+        target *= options.reduction;
+        size_t targetCount = size_t(target / 3.0f) * 3;
+        float error = 0.0f;
+        size_t count = simplifyMesh(level.data(), indices, indexCount, vertices, vertexCount, targetCount,
+                                    options.maxError * extent, &error, options.simplify);
+
+        // a level that barely shrank isn't worth its index range
+        if (count == 0 || float(count) > 0.9f * float(chain.indices.back().size())) break;
+        chain.indices.emplace_back(level.begin(), level.begin() + count);
+        chain.errors.push_back(std::max(error, chain.errors.back()));
+        if (count > targetCount) break;   // stopped by maxError, coarser targets give the same
+    }
+    return chain;
+}
+
+std::vector<Ygg::LodChain> Ygg::generateLodChains(const std::vector<LodSource> &meshes,
+                                                  const LodChainOptions &options, JobSystem *jobs) {
+    std::vector<LodChain> chains(meshes.size());
+    auto generate = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const LodSource &m = meshes[i];
+            chains[i] = generateLodChain(m.vertices, m.vertexCount, m.indices, m.indexCount, options);
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(meshes.size(), 1, generate);
+    } else {
+        generate(0, meshes.size());
+    }
+    return chains;
+}
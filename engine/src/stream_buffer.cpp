@@ -0,0 +1,91 @@
+#include "ygg/stream_buffer.hpp"
+#include <algorithm>
+
+void Ygg::StreamBuffer::init(GLenum target_, size_t regionSize_, unsigned int regions) {
+    target = target_;
+    regionSize = regionSize_;
+    region = 0;
+    cursor = 0;
+    fences.assign(std::max(regions, 1u), nullptr);
+
+    glGenBuffers(1, &id);
+    glBindBuffer(target, id);
+    glBufferData(target, GLsizeiptr(regionSize * fences.size()), nullptr, GL_STREAM_DRAW);
+}
+
+void Ygg::StreamBuffer::destroy() {
+    for (GLsync &fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (id) glDeleteBuffers(1, &id);
+    id = 0;
+}
+
+void Ygg::StreamBuffer::advance() {
+    if (fences[region]) glDeleteSync(fences[region]);
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    region = (region + 1) % fences.size();
+    cursor = 0;
+
+    // with a few frames of slack this fence has almost always signalled already
+    if (GLsync fence = fences[region]) {
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (true) {
+            GLenum result = glClientWaitSync(fence, flags, 1000000); // 1ms
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+            flags = 0;
+        }
+        glDeleteSync(fence);
+        fences[region] = nullptr;
+    }
+}
+
+void Ygg::StreamBuffer::grow(size_t minRegionSize) {
+    // orphaning gives fresh storage: draws already issued keep the old one, so no fence is needed
+    regionSize = std::max(regionSize * 2, minRegionSize);
+    for (GLsync &fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    region = 0;
+    cursor = 0;
+
+    glBindBuffer(target, id);
+    glBufferData(target, GLsizeiptr(regionSize * fences.size()), nullptr, GL_STREAM_DRAW);
+}
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void* Ygg::StreamBuffer::map(size_t size, size_t alignment, GLintptr &offset) {
+    if (alignment == 0) alignment = 1;
+    if (size + alignment > regionSize) grow(size + alignment);
+
+    // align the absolute offset; regions start at multiples of regionSize which need not be aligned
+    size_t base = region * regionSize;
+    size_t start = alignUp(base + cursor, alignment);
+    if (start + size > base + regionSize) {
+        advance();
+        base = region * regionSize;
+        start = alignUp(base, alignment);
+    }
+    cursor = start + size - base;
+    offset = GLintptr(start);
+
+    glBindBuffer(target, id);
+    return glMapBufferRange(target, offset, GLsizeiptr(size),
+                            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void Ygg::StreamBuffer::unmap() {
+    glBindBuffer(target, id);
+    glUnmapBuffer(target);
+}
+
+void Ygg::StreamBuffer::endFrame() {
+    if (!id || cursor == 0) return;
+    advance();
+}
@@ -0,0 +1,360 @@
+#include "ygg/texture.hpp"
+#include "stb/stb_image.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+// EXT_texture_compression_s3tc and EXT_texture_sRGB; not part of the core profile headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace {
+
+bool hasExtension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+        if (extension && std::strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
+
+GLenum compressedFormat(Ygg::BlockFormat format, bool srgb) {
+    switch (format) {
+    case Ygg::BlockFormat::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case Ygg::BlockFormat::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case Ygg::BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    case Ygg::BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    }
+    return GL_RGBA8;
+}
+
+// 2x2 box filter; odd sizes repeat the last row/column
+void downsample(const uint8_t *source, unsigned int width, unsigned int height, uint8_t *destination) {
+    const unsigned int w = std::max(width / 2, 1u), h = std::max(height / 2, 1u);
+    for (unsigned int y = 0; y < h; y++) {
+        unsigned int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        for (unsigned int x = 0; x < w; x++) {
+            unsigned int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            for (unsigned int c = 0; c < 4; c++) {
+                unsigned int sum = source[(size_t(y0) * width + x0) * 4 + c] + source[(size_t(y0) * width + x1) * 4 + c]
+                                 + source[(size_t(y1) * width + x0) * 4 + c] + source[(size_t(y1) * width + x1) * 4 + c];
+                destination[(size_t(y) * w + x) * 4 + c] = uint8_t((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void Ygg::TextureManager::init(JobSystem *jobs_, size_t uploadBudget_) {
+    jobs = jobs_;
+    uploadBudget = uploadBudget_;
+    // handle 0 stays reserved as "no texture"
+    if (slots.empty()) slots.emplace_back();
+
+    const unsigned char white[4] = {255, 255, 255, 255};
+    glGenTextures(1, &placeholder);
+    glBindTexture(GL_TEXTURE_2D, placeholder);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // one budget per frame in flight; a band bigger than that grows the buffer
+    pixelStream.init(GL_PIXEL_UNPACK_BUFFER, std::max<size_t>(uploadBudget, 64 * 1024));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // read by the decoding jobs, which all start after this
+    s3tc = hasExtension("GL_EXT_texture_compression_s3tc");
+    s3tcSrgb = s3tc && hasExtension("GL_EXT_texture_sRGB");
+}
+
+bool Ygg::TextureManager::supportsCompression(BlockFormat format, bool srgb) const {
+    if (format == BlockFormat::BC4 || format == BlockFormat::BC5) return true;
+    return srgb ? s3tcSrgb : s3tc;
+}
+
+void Ygg::TextureManager::destroy() {
+    if (jobs) jobs->wait(decodes);
+    {
+        std::lock_guard<std::mutex> guard(decodedLock);
+        for (Image &image : decoded) freePixels(image);
+        decoded.clear();
+    }
+    for (Image &image : uploads) freePixels(image);
+    uploads.clear();
+
+    for (Slot &slot : slots) {
+        if (slot.texture) glDeleteTextures(1, &slot.texture);
+    }
+    slots.clear();
+    freeHandles.clear();
+    if (placeholder) glDeleteTextures(1, &placeholder);
+    placeholder = 0;
+    pixelStream.destroy();
+}
+
+Ygg::TextureHandle Ygg::TextureManager::load(const std::string &path, const TextureOptions &options) {
+    TextureHandle handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = static_cast<TextureHandle>(slots.size());
+        slots.emplace_back();
+    }
+
+    Slot &slot = slots[handle];
+    slot.texture = 0;
+    slot.width = slot.height = 0;
+    slot.state = TextureState::Loading;
+    slot.options = options;
+    slot.alive = true;
+
+    // unsupported formats quietly stay RGBA8
+    slot.options.compress = options.compress && supportsCompression(options.blockFormat, options.srgb);
+
+    const uint32_t generation = slot.generation;
+    const TextureOptions decodeOptions = slot.options;
+    if (jobs) {
+        jobs->run([this, handle, generation, path, decodeOptions]() {
+            decode(handle, generation, path, decodeOptions);
+        }, &decodes);
+    } else {
+        decode(handle, generation, path, decodeOptions);
+    }
+    return handle;
+}
+
+void Ygg::TextureManager::decode(TextureHandle handle, uint32_t generation, const std::string &path,
+                                 const TextureOptions &options) {
+    // the flip flag is per thread, so decodes on other workers keep their own
+    stbi_set_flip_vertically_on_load_thread(options.flipY ? 1 : 0);
+    int width = 0, height = 0, channels = 0;
+    unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!pixels) std::cerr << "Failed to load texture " << path << ": " << stbi_failure_reason() << "\n";
+
+    Image image{handle, generation, pixels, static_cast<unsigned int>(width), static_cast<unsigned int>(height), 0};
+    if (pixels && options.compress) compress(image, options, jobs);
+    std::lock_guard<std::mutex> guard(decodedLock);
+    decoded.push_back(std::move(image));
+}
+
+void Ygg::TextureManager::compress(Image &image, const TextureOptions &options, JobSystem *jobs) {
+    // the level being compressed and the next one down, swapped each level
+    std::vector<uint8_t> level(image.pixels, image.pixels + size_t(image.width) * image.height * 4), smaller;
+    freePixels(image);
+
+    unsigned int width = image.width, height = image.height;
+    while (true) {
+        CompressedLevel info{image.blocks.size(), width, height};
+        image.levels.push_back(info);
+        image.blocks.resize(info.offset + compressedSize(options.blockFormat, width, height));
+        compressBlocks(level.data(), width, height, options.blockFormat, options.compressQuality,
+                       image.blocks.data() + info.offset, jobs);
+        if (!options.mipmaps || (width == 1 && height == 1)) break;
+
+        smaller.resize(size_t(std::max(width / 2, 1u)) * std::max(height / 2, 1u) * 4);
+        downsample(level.data(), width, height, smaller.data());
+        level.swap(smaller);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+}
+
+bool Ygg::TextureManager::uploaded(const Image &image) {
+    return image.levels.empty() ? image.rowsUploaded >= image.height : image.level >= image.levels.size();
+}
+
+void Ygg::TextureManager::release(TextureHandle handle) {
+    if (handle == 0 || handle >= slots.size() || !slots[handle].alive) return;
+    Slot &slot = slots[handle];
+    if (slot.texture) glDeleteTextures(1, &slot.texture);
+    uint32_t generation = slot.generation + 1;
+    slot = Slot();
+    slot.generation = generation;
+    freeHandles.push_back(handle);
+}
+
+GLuint Ygg::TextureManager::get(TextureHandle handle) const {
+    if (handle >= slots.size() || slots[handle].state != TextureState::Ready) return placeholder;
+    return slots[handle].texture;
+}
+
+void Ygg::TextureManager::bind(TextureHandle handle, unsigned int unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, get(handle));
+}
+
+size_t Ygg::TextureManager::getPendingBytes() const {
+    size_t bytes = 0;
+    auto pending = [](const Image &image) {
+        if (image.levels.empty()) return size_t(image.width) * (image.height - image.rowsUploaded) * 4;
+        if (image.level >= image.levels.size()) return size_t(0);
+        // levels are stored back to back, so the current one ends where the next begins
+        const CompressedLevel &level = image.levels[image.level];
+        size_t end = image.level + 1 < image.levels.size() ? image.levels[image.level + 1].offset : image.blocks.size();
+        size_t done = level.offset + (end - level.offset) * image.rowsUploaded / ((level.height + 3) / 4);
+        return image.blocks.size() - done;
+    };
+    for (const Image &image : uploads) bytes += pending(image);
+    std::lock_guard<std::mutex> guard(decodedLock);
+    for (const Image &image : decoded) bytes += pending(image);
+    return bytes;
+}
+
+void Ygg::TextureManager::update() {
+    {
+        std::lock_guard<std::mutex> guard(decodedLock);
+        uploads.insert(uploads.end(), std::make_move_iterator(decoded.begin()), std::make_move_iterator(decoded.end()));
+        decoded.clear();
+    }
+
+    size_t budget = uploadBudget;
+    bool streamed = false;
+    while (!uploads.empty()) {
+        Image &image = uploads.front();
+        Slot &slot = slots[image.handle];
+        if (!slot.alive || slot.generation != image.generation) {
+            // released while it was decoding
+            freePixels(image);
+            uploads.pop_front();
+            continue;
+        }
+        if (!image.pixels && image.levels.empty()) {
+            slot.state = TextureState::Failed;
+            uploads.pop_front();
+            continue;
+        }
+        // the first band of a frame goes even if it is bigger than the budget
+        size_t copied = image.levels.empty() ? upload(image, budget, !streamed)
+                                             : uploadCompressed(image, budget, !streamed);
+        if (copied == 0) break;
+        budget -= std::min(budget, copied);
+        streamed = true;
+        // a compressed image can end a level with budget to spare
+        if (!uploaded(image)) continue;
+        finish(image);
+        freePixels(image);
+        uploads.pop_front();
+    }
+
+    if (streamed) {
+        pixelStream.endFrame();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+}
+
+size_t Ygg::TextureManager::upload(Image &image, size_t budget, bool force) {
+    Slot &slot = slots[image.handle];
+    if (!slot.texture) {
+        // storage only; with the unpack buffer bound the null pointer would read from it
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glGenTextures(1, &slot.texture);
+        glBindTexture(GL_TEXTURE_2D, slot.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, slot.options.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, GLsizei(image.width),
+                     GLsizei(image.height), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        slot.width = image.width;
+        slot.height = image.height;
+    } else {
+        glBindTexture(GL_TEXTURE_2D, slot.texture);
+    }
+
+    // whole rows only
+    const size_t rowBytes = size_t(image.width) * 4;
+    size_t rows = std::min<size_t>(image.height - image.rowsUploaded, std::max<size_t>(budget / rowBytes, force));
+    if (rows == 0) return 0;
+    size_t size = rows * rowBytes;
+
+    GLintptr offset;
+    void *destination = pixelStream.map(size, 4, offset);
+    if (!destination) return 0;
+    std::memcpy(destination, image.pixels + image.rowsUploaded * rowBytes, size);
+    pixelStream.unmap();
+    // the source is the offset into the bound unpack buffer; the copy runs asynchronously
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, GLint(image.rowsUploaded), GLsizei(image.width), GLsizei(rows),
+                    GL_RGBA, GL_UNSIGNED_BYTE, (void*)(uintptr_t)offset);
+    image.rowsUploaded += static_cast<unsigned int>(rows);
+    return size;
+}
+
+size_t Ygg::TextureManager::uploadCompressed(Image &image, size_t budget, bool force) {
+    Slot &slot = slots[image.handle];
+    const BlockFormat format = slot.options.blockFormat;
+    const GLenum internalFormat = compressedFormat(format, slot.options.srgb);
+    if (!slot.texture) {
+        // every level's storage up front, filled band by band below
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glGenTextures(1, &slot.texture);
+        glBindTexture(GL_TEXTURE_2D, slot.texture);
+        for (size_t l = 0; l < image.levels.size(); l++) {
+            const CompressedLevel &level = image.levels[l];
+            glTexImage2D(GL_TEXTURE_2D, GLint(l), internalFormat, GLsizei(level.width), GLsizei(level.height), 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(image.levels.size() - 1));
+        slot.width = image.width;
+        slot.height = image.height;
+    } else {
+        glBindTexture(GL_TEXTURE_2D, slot.texture);
+    }
+
+    // rows of blocks, as many as the budget allows
+    const CompressedLevel &level = image.levels[image.level];
+    const unsigned int blockRows = (level.height + 3) / 4;
+    const size_t rowBytes = size_t((level.width + 3) / 4) * blockBytes(format);
+    size_t rows = std::min<size_t>(blockRows - image.rowsUploaded, std::max<size_t>(budget / rowBytes, force));
+    if (rows == 0) return 0;
+    size_t size = rows * rowBytes;
+
+    GLintptr offset;
+    void *destination = pixelStream.map(size, 16, offset);
+    if (!destination) return 0;
+    std::memcpy(destination, image.blocks.data() + level.offset + image.rowsUploaded * rowBytes, size);
+    pixelStream.unmap();
+    const unsigned int y = image.rowsUploaded * 4;
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, GLint(image.level), 0, GLint(y), GLsizei(level.width),
+                              GLsizei(std::min<size_t>(rows * 4, level.height - y)), internalFormat, GLsizei(size),
+                              (void*)(uintptr_t)offset);
+
+    image.rowsUploaded += static_cast<unsigned int>(rows);
+    if (image.rowsUploaded == blockRows) {
+        image.level++;
+        image.rowsUploaded = 0;
+    }
+    return size;
+}
+
+void Ygg::TextureManager::finish(const Image &image) {
+    Slot &slot = slots[image.handle];
+    glBindTexture(GL_TEXTURE_2D, slot.texture);
+    if (!image.levels.empty()) {
+        // compressed: the levels came with the image
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    } else if (slot.options.mipmaps) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    slot.state = TextureState::Ready;
+}
+
+void Ygg::TextureManager::freePixels(Image &image) {
+    if (image.pixels) stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
@@ -0,0 +1,132 @@
+#include "ygg/transform.hpp"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define YGG_TRANSFORM_SSE 1
+#endif
+
+namespace {
+
+// Columns of inverse(M)^T are (b x c, c x a, a x b) / det for M = [a b c]
+void cofactorNormalMatrix(const glm::mat4 &model, Ygg::NormalMatrix &out) {
+    glm::vec3 a(model[0]), b(model[1]), c(model[2]);
+    glm::vec3 bc = glm::cross(b, c);
+    glm::vec3 ca = glm::cross(c, a);
+    glm::vec3 ab = glm::cross(a, b);
+    float det = glm::dot(a, bc);
+    float inv = det != 0.0f ? 1.0f / det : 0.0f;
+
+    out.columns[0] = glm::vec4(bc * inv, 0.0f);
+    out.columns[1] = glm::vec4(ca * inv, 0.0f);
+    out.columns[2] = glm::vec4(ab * inv, 0.0f);
+}
+
+// Shared kernel; out advances by outStride bytes so it can fill InstanceData records in place
+void normalMatricesStrided(const glm::mat4 *models, size_t count, unsigned char *out, size_t outStride) {
+    size_t i = 0;
+
+#ifdef YGG_TRANSFORM_SSE
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        // load column j of the four matrices and transpose to SoA: x[j] holds the x of column j for all four
+        __m128 x[3], y[3], z[3];
+        for (int j = 0; j < 3; j++) {
+            __m128 c0 = _mm_loadu_ps(&models[i + 0][j][0]);
+            __m128 c1 = _mm_loadu_ps(&models[i + 1][j][0]);
+            __m128 c2 = _mm_loadu_ps(&models[i + 2][j][0]);
+            __m128 c3 = _mm_loadu_ps(&models[i + 3][j][0]);
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            x[j] = c0; y[j] = c1; z[j] = c2;
+        }
+
+        // cross products of column pairs: r[0] = b x c, r[1] = c x a, r[2] = a x b
+        __m128 rx[3], ry[3], rz[3];
+        for (int j = 0; j < 3; j++) {
+            int p = (j + 1) % 3, q = (j + 2) % 3;
+            rx[j] = _mm_sub_ps(_mm_mul_ps(y[p], z[q]), _mm_mul_ps(z[p], y[q]));
+            ry[j] = _mm_sub_ps(_mm_mul_ps(z[p], x[q]), _mm_mul_ps(x[p], z[q]));
+            rz[j] = _mm_sub_ps(_mm_mul_ps(x[p], y[q]), _mm_mul_ps(y[p], x[q]));
+        }
+
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x[0], rx[0]), _mm_mul_ps(y[0], ry[0])), _mm_mul_ps(z[0], rz[0]));
+        // singular transforms get a zero normal matrix instead of inf/nan
+        __m128 inv = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), det), _mm_cmpneq_ps(det, zero));
+
+        for (int j = 0; j < 3; j++) {
+            __m128 c0 = _mm_mul_ps(rx[j], inv);
+            __m128 c1 = _mm_mul_ps(ry[j], inv);
+            __m128 c2 = _mm_mul_ps(rz[j], inv);
+            __m128 c3 = zero;
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + (i + 0) * outStride) + 4 * j, c0);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + (i + 1) * outStride) + 4 * j, c1);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + (i + 2) * outStride) + 4 * j, c2);
+            _mm_storeu_ps(reinterpret_cast<float*>(out + (i + 3) * outStride) + 4 * j, c3);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        Ygg::NormalMatrix n;
+        cofactorNormalMatrix(models[i], n);
+        std::memcpy(out + i * outStride, &n, sizeof(n));
+    }
+}
+
+} // namespace
+
+Ygg::NormalMatrix Ygg::computeNormalMatrix(const glm::mat4 &model) {
+    glm::vec3 a(model[0]), b(model[1]), c(model[2]);
+    float aa = glm::dot(a, a), bb = glm::dot(b, b), cc = glm::dot(c, c);
+
+    // rigid or uniformly scaled (s * R): inverse-transpose is R / s, i.e. M / s^2
+    const float eps = 1e-5f * aa;
+    if (std::fabs(aa - bb) <= eps && std::fabs(aa - cc) <= eps &&
+        std::fabs(glm::dot(a, b)) <= eps && std::fabs(glm::dot(b, c)) <= eps && std::fabs(glm::dot(a, c)) <= eps &&
+        aa > 0.0f) {
+        float inv = 1.0f / aa;
+        NormalMatrix n;
+        n.columns[0] = glm::vec4(a * inv, 0.0f);
+        n.columns[1] = glm::vec4(b * inv, 0.0f);
+        n.columns[2] = glm::vec4(c * inv, 0.0f);
+        return n;
+    }
+
+    NormalMatrix n;
+    cofactorNormalMatrix(model, n);
+    return n;
+}
+
+glm::mat4 Ygg::multiplyTransform(const glm::mat4 &a, const glm::mat4 &b) {
+#ifdef YGG_TRANSFORM_SSE
+    // column j of the product is a's columns weighted by column j of b
+    __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    glm::mat4 out;
+    for (int j = 0; j < 4; j++) {
+        __m128 c = _mm_mul_ps(a0, _mm_set1_ps(b[j][0]));
+        c = _mm_add_ps(c, _mm_mul_ps(a1, _mm_set1_ps(b[j][1])));
+        c = _mm_add_ps(c, _mm_mul_ps(a2, _mm_set1_ps(b[j][2])));
+        c = _mm_add_ps(c, _mm_mul_ps(a3, _mm_set1_ps(b[j][3])));
+        _mm_storeu_ps(&out[j][0], c);
+    }
+    return out;
+#else
+    return a * b;
+#endif
+}
+
+void Ygg::computeNormalMatrices(const glm::mat4 *models, size_t count, NormalMatrix *out) {
+    normalMatricesStrided(models, count, reinterpret_cast<unsigned char*>(out), sizeof(NormalMatrix));
+}
+
+void Ygg::packInstanceData(const glm::mat4 *models, size_t count, InstanceData *out) {
+    for (size_t i = 0; i < count; i++) out[i].model = models[i];
+    normalMatricesStrided(models, count, reinterpret_cast<unsigned char*>(out) + offsetof(InstanceData, normal),
+                          sizeof(InstanceData));
+}
@@ -0,0 +1,116 @@
+#include "ygg/vertex_layout.hpp"
+#include "glm/gtc/packing.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const Ygg::VertexLayout layouts[Ygg::VERTEX_FORMAT_COUNT] = {
+    // Standard
+    {sizeof(Ygg::Vertex), {
+        {0, 3, GL_FLOAT, GL_FALSE, offsetof(Ygg::Vertex, pos)},
+        {1, 3, GL_FLOAT, GL_FALSE, offsetof(Ygg::Vertex, normal)},
+        {2, 3, GL_FLOAT, GL_FALSE, offsetof(Ygg::Vertex, color)}}},
+    // Compact; packed formats must be read with size 4, the shader just ignores w
+    {sizeof(Ygg::CompactVertex), {
+        {0, 3, GL_FLOAT, GL_FALSE, offsetof(Ygg::CompactVertex, pos)},
+        {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(Ygg::CompactVertex, normal)},
+        {2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Ygg::CompactVertex, color)}}},
+    // CompactHalf
+    {sizeof(Ygg::PackedVertex), {
+        {0, 3, GL_HALF_FLOAT, GL_FALSE, offsetof(Ygg::PackedVertex, pos)},
+        {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(Ygg::PackedVertex, normal)},
+        {2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Ygg::PackedVertex, color)}}},
+    // CompactQuantized
+    {sizeof(Ygg::PackedVertex), {
+        {0, 3, GL_SHORT, GL_TRUE, offsetof(Ygg::PackedVertex, pos)},
+        {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(Ygg::PackedVertex, normal)},
+        {2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Ygg::PackedVertex, color)}}},
+};
+
+uint32_t packNormal(const glm::vec3 &normal) {
+    return glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+}
+
+uint32_t packColor(const glm::vec3 &color) {
+    return glm::packUnorm4x8(glm::vec4(glm::clamp(color, 0.0f, 1.0f), 1.0f));
+}
+
+} // namespace
+
+void Ygg::VertexLayout::apply() const {
+    for (const VertexAttribute &a : attributes) {
+        glVertexAttribPointer(a.location, a.size, a.type, a.normalized, stride, (void*)(uintptr_t)a.offset);
+        glEnableVertexAttribArray(a.location);
+    }
+}
+
+const Ygg::VertexLayout& Ygg::getVertexLayout(VertexFormat format) {
+    return layouts[static_cast<unsigned int>(format)];
+}
+
+Ygg::Dequantize Ygg::encodeVertices(VertexFormat format, const Vertex *vertices, size_t count, void *dst) {
+    Dequantize dequantize(0.0f, 0.0f, 0.0f, 1.0f);
+
+    switch (format) {
+    case VertexFormat::Standard:
+        std::memcpy(dst, vertices, count * sizeof(Vertex));
+        break;
+
+    case VertexFormat::Compact: {
+        CompactVertex *out = static_cast<CompactVertex*>(dst);
+        for (size_t i = 0; i < count; i++) {
+            out[i].pos = vertices[i].pos;
+            out[i].normal = packNormal(vertices[i].normal);
+            out[i].color = packColor(vertices[i].color);
+        }
+        break;
+    }
+
+    case VertexFormat::CompactHalf: {
+        PackedVertex *out = static_cast<PackedVertex*>(dst);
+        for (size_t i = 0; i < count; i++) {
+            for (int c = 0; c < 3; c++) out[i].pos[c] = glm::packHalf1x16(vertices[i].pos[c]);
+            out[i].pos[3] = 0;
+            out[i].normal = packNormal(vertices[i].normal);
+            out[i].color = packColor(vertices[i].color);
+        }
+        break;
+    }
+
+    case VertexFormat::CompactQuantized: {
+        // centre the bounds on the origin and scale the largest half-extent to 1
+        glm::vec3 lo(0.0f), hi(0.0f);
+        if (count > 0) lo = hi = vertices[0].pos;
+        for (size_t i = 1; i < count; i++) {
+            lo = glm::min(lo, vertices[i].pos);
+            hi = glm::max(hi, vertices[i].pos);
+        }
+        glm::vec3 center = (lo + hi) * 0.5f;
+        glm::vec3 halfExtent = (hi - lo) * 0.5f;
+        float scale = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+        if (scale <= 0.0f) scale = 1.0f;
+
+        PackedVertex *out = static_cast<PackedVertex*>(dst);
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 p = (vertices[i].pos - center) / scale;
+            for (int c = 0; c < 3; c++) out[i].pos[c] = glm::packSnorm1x16(p[c]);
+            out[i].pos[3] = 0;
+            out[i].normal = packNormal(vertices[i].normal);
+            out[i].color = packColor(vertices[i].color);
+        }
+        dequantize = Dequantize(center, scale);
+        break;
+    }
+    }
+    return dequantize;
+}
+
+glm::mat4 Ygg::applyDequantize(const glm::mat4 &model, const Dequantize &dequantize) {
+    glm::mat4 out;
+    out[0] = model[0] * dequantize.w;
+    out[1] = model[1] * dequantize.w;
+    out[2] = model[2] * dequantize.w;
+    out[3] = model[0] * dequantize.x + model[1] * dequantize.y + model[2] * dequantize.z + model[3];
+    return out;
+}
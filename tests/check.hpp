@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdio>
+
+// assert() that still runs in release builds and lets the remaining checks run; main returns
+// checkFailures() so CTest sees the result
+inline int &checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            checkFailures()++;                                                             \
+        }                                                                                  \
+    } while (0)
@@ -0,0 +1,53 @@
+#include "check.hpp"
+#include "ygg/block_compress.hpp"
+#include <cmath>
+#include <vector>
+
+int main() {
+    // smooth gradients with an edge, 37x21 so the right and bottom blocks are partial
+    const unsigned int width = 37, height = 21;
+    std::vector<uint8_t> rgba(width * height * 4);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            uint8_t *p = &rgba[(y * width + x) * 4];
+            p[0] = static_cast<uint8_t>(x * 255 / (width - 1));
+            p[1] = static_cast<uint8_t>(y * 255 / (height - 1));
+            p[2] = x < width / 2 ? 40 : 200;
+            p[3] = static_cast<uint8_t>((x + y) * 4);
+        }
+    }
+
+    CHECK(Ygg::compressedSize(Ygg::BlockFormat::BC1, width, height) == 10 * 6 * 8);
+    CHECK(Ygg::compressedSize(Ygg::BlockFormat::BC5, width, height) == 10 * 6 * 16);
+
+    Ygg::JobSystem jobs;
+    jobs.init(2);
+    for (Ygg::BlockFormat format : {Ygg::BlockFormat::BC1, Ygg::BlockFormat::BC3, Ygg::BlockFormat::BC4,
+                                    Ygg::BlockFormat::BC5}) {
+        std::vector<uint8_t> blocks(Ygg::compressedSize(format, width, height));
+        Ygg::compressBlocks(rgba.data(), width, height, format, Ygg::CompressQuality::Normal, blocks.data());
+        Ygg::CompressionReport report = Ygg::measureCompression(rgba.data(), blocks.data(), width, height, format);
+        CHECK(report.psnr > 30.0f);
+        if (format == Ygg::BlockFormat::BC3) CHECK(report.alphaPsnr > 30.0f);
+
+        // spreading block rows over jobs gives the same blocks
+        std::vector<uint8_t> parallel(blocks.size());
+        Ygg::compressBlocks(rgba.data(), width, height, format, Ygg::CompressQuality::Normal, parallel.data(), &jobs);
+        CHECK(parallel == blocks);
+
+        // a decoded image encodes back close to itself
+        std::vector<uint8_t> decoded(rgba.size());
+        Ygg::decompressBlocks(blocks.data(), width, height, format, decoded.data());
+        std::vector<uint8_t> again(blocks.size());
+        Ygg::compressBlocks(decoded.data(), width, height, format, Ygg::CompressQuality::Normal, again.data());
+        CHECK(Ygg::measureCompression(decoded.data(), again.data(), width, height, format).psnr > 40.0f);
+    }
+
+    // a flat block is stored exactly
+    std::vector<uint8_t> flat(4 * 4 * 4, 128);
+    std::vector<uint8_t> block(8);
+    Ygg::compressBlocks(flat.data(), 4, 4, Ygg::BlockFormat::BC4, Ygg::CompressQuality::Fast, block.data());
+    CHECK(std::isinf(Ygg::measureCompression(flat.data(), block.data(), 4, 4, Ygg::BlockFormat::BC4).psnr));
+    jobs.shutdown();
+    return checkFailures() ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+#include "check.hpp"
+#include "ygg/bvh.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+Ygg::Aabb randomBox(std::mt19937 &rng) {
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f), size(0.1f, 4.0f);
+    Ygg::Aabb box;
+    box.min = glm::vec3(position(rng), position(rng), position(rng));
+    box.max = box.min + glm::vec3(size(rng), size(rng), size(rng));
+    return box;
+}
+
+bool outsideFrustum(const Ygg::Frustum &frustum, const Ygg::Aabb &box) {
+    for (const glm::vec4 &plane : frustum.planes) {
+        glm::vec3 positive(plane.x >= 0.0f ? box.max.x : box.min.x, plane.y >= 0.0f ? box.max.y : box.min.y,
+                           plane.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(3);
+    Ygg::DynamicBvh bvh;
+    std::vector<int32_t> proxies;
+    for (uint32_t i = 0; i < 500; i++) proxies.push_back(bvh.insert(randomBox(rng), i));
+    // churn: move some far, drop some
+    for (uint32_t i = 0; i < 500; i += 3) bvh.move(proxies[i], randomBox(rng));
+    for (uint32_t i = 0; i < 500; i += 7) {
+        bvh.remove(proxies[i]);
+        proxies[i] = Ygg::DynamicBvh::NullNode;
+    }
+    CHECK(bvh.size() == 500 - 72);
+    // AVL-style balancing keeps the height near log2 of the leaf count
+    CHECK(bvh.getHeight() < 20);
+
+    auto sorted = [](std::vector<uint32_t> values) {
+        std::sort(values.begin(), values.end());
+        return values;
+    };
+
+    for (int query = 0; query < 50; query++) {
+        Ygg::Aabb region = randomBox(rng);
+        region.max += glm::vec3(10.0f);
+        std::vector<uint32_t> found, expected;
+        bvh.queryAabb(region, found);
+        for (int32_t proxy : proxies) {
+            if (proxy != Ygg::DynamicBvh::NullNode && bvh.getFatAabb(proxy).overlaps(region)) {
+                expected.push_back(bvh.getUserData(proxy));
+            }
+        }
+        CHECK(sorted(found) == sorted(expected));
+
+        glm::vec3 origin = randomBox(rng).min, direction = randomBox(rng).min - origin;
+        if (query % 5 == 0) direction.y = 0.0f;
+        std::vector<Ygg::RayHit> hits;
+        bvh.queryRay(origin, direction, 1.0f, hits);
+        found.clear();
+        expected.clear();
+        for (const Ygg::RayHit &hit : hits) found.push_back(hit.userData);
+        for (int32_t proxy : proxies) {
+            if (proxy != Ygg::DynamicBvh::NullNode &&
+                Ygg::intersectRay(bvh.getFatAabb(proxy), origin, direction, 1.0f) >= 0.0f) {
+                expected.push_back(bvh.getUserData(proxy));
+            }
+        }
+        CHECK(sorted(found) == sorted(expected));
+        CHECK(std::is_sorted(hits.begin(), hits.end(),
+                             [](const Ygg::RayHit &a, const Ygg::RayHit &b) { return a.distance < b.distance; }));
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 60.0f), glm::vec3(10.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Ygg::Frustum frustum = Ygg::Frustum::fromMatrix(glm::perspective(glm::radians(40.0f), 1.5f, 1.0f, 80.0f) * view);
+    std::vector<uint32_t> found, expected;
+    bvh.queryFrustum(frustum, found);
+    for (int32_t proxy : proxies) {
+        if (proxy != Ygg::DynamicBvh::NullNode && !outsideFrustum(frustum, bvh.getFatAabb(proxy))) {
+            expected.push_back(bvh.getUserData(proxy));
+        }
+    }
+    CHECK(!expected.empty() && expected.size() < bvh.size());
+    CHECK(sorted(found) == sorted(expected));
+
+    // a ray along a box face, with zero direction components, still hits
+    Ygg::Aabb unit;
+    unit.max = glm::vec3(1.0f);
+    CHECK(Ygg::intersectRay(unit, glm::vec3(0.0f, 0.5f, -1.0f), glm::vec3(0.0f, 0.0f, 1.0f), 10.0f) == 1.0f);
+    CHECK(Ygg::intersectRay(unit, glm::vec3(-0.5f, 0.5f, -1.0f), glm::vec3(0.0f, 0.0f, 1.0f), 10.0f) < 0.0f);
+    return checkFailures() ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#include "check.hpp"
+#include "ygg/lod.hpp"
+
+int main() {
+    Ygg::MeshLod lods[3];
+    lods[1].error = 0.01f;
+    lods[2].error = 0.04f;
+    const float budget = 1.0f, hysteresis = 0.25f;
+
+    // pixelsPerUnit where level 1's error is exactly the budget
+    const float threshold = budget / lods[1].error;
+    CHECK(Ygg::selectLod(lods, 3, threshold * 2.0f, 0, budget, hysteresis) == 0);
+    CHECK(Ygg::selectLod(lods, 3, threshold / 10.0f, 0, budget, hysteresis) == 2);
+    CHECK(Ygg::selectLod(lods, 1, 0.0f, 0, budget, hysteresis) == 0);
+
+    // just inside the threshold: coarsening waits for the stricter budget, staying coarse doesn't
+    const float inside = threshold * 0.9f;
+    CHECK(Ygg::selectLod(lods, 3, inside, 0, budget, hysteresis) == 0);
+    CHECK(Ygg::selectLod(lods, 3, inside, 1, budget, hysteresis) == 1);
+    // past the hysteresis band both agree
+    CHECK(Ygg::selectLod(lods, 3, threshold * 0.7f, 0, budget, hysteresis) == 1);
+    // refining is never delayed
+    CHECK(Ygg::selectLod(lods, 3, threshold * 1.1f, 1, budget, hysteresis) == 0);
+
+    CHECK(Ygg::pixelsPerUnit(1.0f, 600.0f, 10.0f) == 30.0f);
+    CHECK(Ygg::pixelsPerUnit(1.0f, 600.0f, 0.0f) > 0.0f);
+    return checkFailures() ? 1 : 0;
+}
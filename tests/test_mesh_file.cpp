@@ -0,0 +1,110 @@
+#include "check.hpp"
+#include "ygg/mesh_file.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+std::string readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string &path, const std::string &bytes) {
+    std::ofstream(path, std::ios::binary).write(bytes.data(), std::streamsize(bytes.size()));
+}
+
+// position of the first 8-byte aligned value equal to value from from on; the record layout is private
+size_t findValue(const std::string &bytes, uint64_t value, size_t from) {
+    for (size_t i = from; i + 8 <= bytes.size(); i += 8) {
+        uint64_t v;
+        std::memcpy(&v, bytes.data() + i, 8);
+        if (v == value) return i;
+    }
+    return std::string::npos;
+}
+
+} // namespace
+
+int main() {
+    // a 10x10 grid with a two triangle second LOD
+    const int n = 10;
+    std::vector<Ygg::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (int y = 0; y <= n; y++) {
+        for (int x = 0; x <= n; x++) {
+            vertices.push_back({glm::vec3(x, y, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f)});
+        }
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            uint32_t a = y * (n + 1) + x;
+            indices.insert(indices.end(), {a, a + 1, a + n + 2, a, a + n + 2, a + n + 1});
+        }
+    }
+    const uint32_t lod1 = static_cast<uint32_t>(indices.size());
+    const uint32_t corner = (n + 1) * (n + 1) - 1;
+    indices.insert(indices.end(), {0, n, corner, 0, corner, corner - n});
+
+    std::vector<Ygg::EncodedMesh> meshes;
+    meshes.push_back(Ygg::encodeMesh(vertices, indices, Ygg::VertexFormat::CompactQuantized, {0, lod1}, {0.0f, 0.5f}));
+    meshes.back().name = "grid";
+    const std::string path = "test_mesh_file.yggmesh";
+    CHECK(Ygg::writeMeshFile(path, meshes));
+
+    Ygg::MeshFile file;
+    CHECK(file.open(path));
+    CHECK(file.size() == 1 && file.find("grid") == 0 && file.find("other") == -1);
+    if (file.size() == 1) {
+        const Ygg::MeshData &loaded = file.mesh(0);
+        const Ygg::MeshData source = meshes[0].view();
+        CHECK(loaded.vertexCount == source.vertexCount && loaded.indexBytes == source.indexBytes);
+        CHECK(std::memcmp(loaded.vertices, source.vertices, meshes[0].vertices.size()) == 0);
+        CHECK(std::memcmp(loaded.indices, source.indices, source.indexBytes) == 0);
+        CHECK(reinterpret_cast<uintptr_t>(loaded.vertices) % Ygg::MESH_FILE_ALIGNMENT == 0);
+        CHECK(loaded.lodCount == 2 && loaded.lods[1].indexCount == 6);
+    }
+    file.close();
+
+    const std::string bytes = readFile(path);
+    const std::string bad = "test_mesh_file_bad.yggmesh";
+
+    writeFile(bad, bytes.substr(0, bytes.size() - 1));
+    CHECK(!file.open(bad));
+
+    // the blobs are stored as encoded, so their offsets can be found by content
+    const size_t vertexStart = bytes.find(std::string(meshes[0].vertices.begin(), meshes[0].vertices.end()));
+    const size_t indexStart = bytes.find(std::string(meshes[0].indices.begin(), meshes[0].indices.end()), vertexStart);
+    CHECK(vertexStart != std::string::npos && indexStart != std::string::npos);
+
+    // a vertex offset close to 2^64 must not wrap around the bounds check
+    const size_t at = findValue(bytes, vertexStart, Ygg::MESH_FILE_ALIGNMENT);
+    CHECK(at != std::string::npos && at < vertexStart);
+    if (at != std::string::npos) {
+        std::string wrapped = bytes;
+        const uint64_t huge = ~uint64_t(0) - (Ygg::MESH_FILE_ALIGNMENT - 1);
+        std::memcpy(&wrapped[at], &huge, 8);
+        writeFile(bad, wrapped);
+        CHECK(!file.open(bad));
+    }
+
+    // an index past the vertices
+    if (indexStart != std::string::npos) {
+        std::string outOfRange = bytes;
+        std::memset(&outOfRange[indexStart], 0xFF, 2);
+        writeFile(bad, outOfRange);
+        CHECK(!file.open(bad));
+    }
+
+    std::string notMesh = bytes;
+    notMesh[0] = 'X';
+    writeFile(bad, notMesh);
+    CHECK(!file.open(bad));
+    CHECK(!file.getError().empty());
+
+    std::remove(path.c_str());
+    std::remove(bad.c_str());
+    return checkFailures() ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+#include "check.hpp"
+#include "ygg/occlusion.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+int main() {
+    // camera at the origin looking down -z, a wall filling the middle of the view at z = -10
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f);
+
+    Ygg::JobSystem jobs;
+    jobs.init(2);
+    for (Ygg::JobSystem *workers : {static_cast<Ygg::JobSystem*>(nullptr), &jobs}) {
+        Ygg::OcclusionCuller culler;
+        culler.init(256, 128, workers);
+        culler.beginFrame(projection * view);
+        culler.addOccluderBox(glm::vec3(-4.0f, -4.0f, -11.0f), glm::vec3(4.0f, 4.0f, -10.0f), glm::mat4(1.0f));
+        culler.rasterize();
+        CHECK(culler.getOccluderTriangles() > 0);
+
+        // a small box straight behind the wall is hidden
+        CHECK(!culler.isVisible(glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -20.0f)));
+        CHECK(!culler.isSphereVisible(glm::vec4(0.0f, 0.0f, -20.0f, 1.0f)));
+        // in front of the wall, or behind it but beside it, is not
+        CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -5.0f)));
+        CHECK(culler.isSphereVisible(glm::vec4(0.0f, 0.0f, -5.0f, 1.0f)));
+        CHECK(culler.isVisible(glm::vec3(18.0f, -1.0f, -21.0f), glm::vec3(20.0f, 1.0f, -20.0f)));
+        // boxes crossing the near plane always count as visible
+        CHECK(culler.isVisible(glm::vec3(-1.0f), glm::vec3(1.0f)));
+
+        // a new frame without occluders hides nothing
+        culler.beginFrame(projection * view);
+        culler.rasterize();
+        CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -20.0f)));
+    }
+    jobs.shutdown();
+    return checkFailures() ? 1 : 0;
+}
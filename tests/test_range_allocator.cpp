@@ -0,0 +1,40 @@
+#include "check.hpp"
+#include "ygg/geometry_pool.hpp"
+
+int main() {
+    Ygg::RangeAllocator allocator;
+    allocator.reset(300);
+    uint32_t a, b, c, d;
+    CHECK(allocator.allocate(100, 1, a) && a == 0);
+    CHECK(allocator.allocate(100, 1, b) && b == 100);
+    CHECK(allocator.allocate(100, 1, c) && c == 200);
+    CHECK(allocator.freeSpace() == 0);
+    CHECK(!allocator.allocate(1, 1, d));
+
+    // freeing the ends leaves a hole at the front and a trailing block
+    allocator.free(a, 100);
+    allocator.free(c, 100);
+    CHECK(allocator.freeSpace() == 200);
+    CHECK(allocator.holeSpace() == 100);
+    CHECK(!allocator.allocate(150, 1, d));
+
+    // freeing the middle coalesces everything into one range
+    allocator.free(b, 100);
+    CHECK(allocator.freeSpace() == 300);
+    CHECK(allocator.holeSpace() == 0);
+    CHECK(allocator.allocate(300, 1, d) && d == 0);
+    allocator.free(d, 300);
+
+    // alignment padding goes back on the free list
+    CHECK(allocator.allocate(10, 1, a) && a == 0);
+    CHECK(allocator.allocate(10, 64, b) && b == 64);
+    CHECK(allocator.allocate(54, 1, c) && c == 10);
+    CHECK(allocator.freeSpace() == 300 - 74);
+
+    // growing extends the trailing block
+    allocator.reset(100, 100);
+    allocator.grow(200);
+    CHECK(allocator.freeSpace() == 100);
+    CHECK(allocator.allocate(100, 1, d) && d == 100);
+    return checkFailures() ? 1 : 0;
+}
@@ -0,0 +1,38 @@
+#include "check.hpp"
+#include "ygg/render_queue.hpp"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+int main() {
+    std::mt19937_64 rng(7);
+    for (size_t n : {size_t(0), size_t(1), size_t(17), size_t(5000)}) {
+        // few distinct keys, so stability is exercised, spread over every byte
+        std::vector<uint64_t> keys(n);
+        for (uint64_t &key : keys) key = (rng() % 64) * 0x0101010101010101ull;
+        std::vector<uint32_t> order(n);
+        std::iota(order.begin(), order.end(), 0u);
+
+        std::vector<std::pair<uint64_t, uint32_t>> expected(n);
+        for (size_t i = 0; i < n; i++) expected[i] = {keys[i], order[i]};
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        std::vector<uint64_t> keysScratch;
+        std::vector<uint32_t> orderScratch;
+        Ygg::radixSortKeys(keys, order, keysScratch, orderScratch);
+        bool same = keys.size() == n && order.size() == n;
+        for (size_t i = 0; same && i < n; i++) same = keys[i] == expected[i].first && order[i] == expected[i].second;
+        CHECK(same);
+    }
+
+    // keys sharing every byte but one skip the other passes
+    std::vector<uint64_t> keys = {0xAB00000000000003ull, 0xAB00000000000001ull, 0xAB00000000000002ull};
+    std::vector<uint32_t> order = {0, 1, 2};
+    std::vector<uint64_t> keysScratch;
+    std::vector<uint32_t> orderScratch;
+    Ygg::radixSortKeys(keys, order, keysScratch, orderScratch);
+    CHECK(order[0] == 1 && order[1] == 2 && order[2] == 0);
+    CHECK(std::is_sorted(keys.begin(), keys.end()));
+    return checkFailures() ? 1 : 0;
+}